@@ -0,0 +1,66 @@
+#include "Allocations.h"
+
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+
+namespace
+{
+    const unsigned int  SLOTS = 256;
+
+    // Padded out to a cache line each, so that threads do not fight over them
+    struct alignas( 64 ) Slot
+    {
+        std::atomic<uint64_t>   count;
+        std::atomic<uint64_t>   bytes;
+    };
+    Slot                        slots[SLOTS];
+    std::atomic<unsigned int>   nextSlot( 0 );
+
+    // Plain data, so that the first allocation on a thread never has to construct anything
+    thread_local Slot*          local = nullptr;
+
+    void    record( size_t size )
+    {
+        if( local == nullptr )
+            local = &slots[nextSlot++ % SLOTS];
+
+        local->count.fetch_add( 1, std::memory_order_relaxed );
+        local->bytes.fetch_add( size, std::memory_order_relaxed );
+    }
+}
+
+uint64_t    Allocations::count()
+{
+    uint64_t total = 0;
+    for( unsigned int i = 0; i < SLOTS; ++i )
+        total += slots[i].count.load( std::memory_order_relaxed );
+    return total;
+}
+uint64_t    Allocations::bytes()
+{
+    uint64_t total = 0;
+    for( unsigned int i = 0; i < SLOTS; ++i )
+        total += slots[i].bytes.load( std::memory_order_relaxed );
+    return total;
+}
+
+// Replacements for the global allocation functions. The array and nothrow forms are defined by the standard library
+//  in terms of these.
+void*   operator new( size_t size )
+{
+    record( size );
+
+    void* p = malloc( size == 0 ? 1 : size );
+    if( p == nullptr )
+        throw std::bad_alloc();
+    return p;
+}
+void    operator delete( void* p ) noexcept
+{
+    free( p );
+}
+void    operator delete( void* p, size_t ) noexcept
+{
+    free( p );
+}
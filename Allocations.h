@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// Counts every call to the global operator new, so that we can check the generation loop leaves the allocator alone.
+// Each thread counts into its own slot, so counting costs an uncontended add.
+namespace Allocations
+{
+    // Allocations made by every thread since the program started
+    uint64_t        count();
+    // Bytes asked for by those allocations
+    uint64_t        bytes();
+}
@@ -0,0 +1,362 @@
+#include "Batch.h"
+
+#include <thread>
+#include <stdexcept>
+#include <stdlib.h>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+const char*     Batch::USAGE =
+    "GA_Joints --batch results.csv [--seeds 1-8,20] [--time 60,300] [--family 2000,10000] [--intensity 2.5,3]\n"
+    "          [--mutations 1:1:1:2,2:1:1:1] [--scheduler fixed,adaptive] [--threads 1] [--concurrent n]\n"
+    "          [--generations n] [--evaluations n] [--stagnation n] [--epsilon e] [--target f]\n"
+    "Every setting up to --scheduler takes a list separated by commas, and seeds can also be given as ranges. Each seed\n"
+    " is run with every combination of the settings. --mutations gives the relative chances of addNode, removeNode,\n"
+    " thicken and moveNode, which --scheduler adaptive only starts from (see Scheduler.h). Each run gets --threads\n"
+    " threads, and --concurrent runs go at once (enough to fill the hardware by default).\n"
+    "A run stops at the end of its --time, or sooner after --generations generations or --evaluations evaluations, once\n"
+    " its fittest reaches --target, or once neither its fittest nor its mean fitness has improved by more than\n"
+    " --epsilon (0 by default) in --stagnation generations. Those are off unless given, see Stopping.h.";
+
+namespace
+{
+    std::vector<std::string>    split( const std::string& text, char separator )
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        for( ;; )
+        {
+            size_t end = text.find( separator, start );
+            parts.push_back( text.substr( start, end - start ) );
+            if( end == std::string::npos )
+                return parts;
+            start = end + 1;
+        }
+    }
+
+    const char* const   SCHEDULINGS[] = { "fixed", "adaptive" };
+
+    bool        toNumber( const std::string& text, double& value )
+    {
+        char* end;
+        value = strtod( text.c_str(), &end );
+        return !text.empty() && *end == '\0';
+    }
+    bool        toNumber( const std::string& text, uint64_t& value )
+    {
+        char* end;
+        value = strtoull( text.c_str(), &end, 10 );
+        return !text.empty() && text[0] != '-' && *end == '\0';
+    }
+    bool        toNumber( const std::string& text, unsigned int& value )
+    {
+        uint64_t wide;
+        if( !toNumber( text, wide ) || wide > ~0u )
+            return false;
+        value = (unsigned int)wide;
+        return true;
+    }
+
+    bool        toNumber( const std::string& text, MutationScheduler::Mode& value )
+    {
+        for( unsigned int i = 0; i < sizeof( SCHEDULINGS ) / sizeof( SCHEDULINGS[0] ); ++i )
+        {
+            if( text == SCHEDULINGS[i] )
+            {
+                value = (MutationScheduler::Mode)i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename T>
+    bool        toList( const std::string& text, std::vector<T>& values )
+    {
+        values.clear();
+        std::vector<std::string> parts = split( text, ',' );
+        for( auto i = parts.begin(); i != parts.end(); ++i )
+        {
+            T value;
+            if( !toNumber( *i, value ) )
+                return false;
+            values.push_back( value );
+        }
+        return true;
+    }
+
+    // Single seeds and inclusive ranges such as 1-8
+    bool        toSeeds( const std::string& text, std::vector<uint64_t>& seeds )
+    {
+        seeds.clear();
+        std::vector<std::string> parts = split( text, ',' );
+        for( auto i = parts.begin(); i != parts.end(); ++i )
+        {
+            size_t dash = i->find( '-', 1 );
+            uint64_t first;
+            uint64_t last;
+
+            if( dash == std::string::npos )
+            {
+                if( !toNumber( *i, first ) )
+                    return false;
+                last = first;
+            }
+            else if( !toNumber( i->substr( 0, dash ), first ) || !toNumber( i->substr( dash + 1 ), last ) || last < first || last - first >= 1000000 )
+                return false;
+
+            for( uint64_t seed = first; seed <= last; ++seed )
+                seeds.push_back( seed );
+        }
+        return true;
+    }
+}
+
+Batch::Batch()
+    : _seeds( 1, 1 ), _times( 1, 60.0 ), _familySizes( 1, 2000 ), _intensities( 1, Truss::fitnessIntensity ),
+      _mutationWeights( 1, std::vector<unsigned int>( Truss::mutationWeights, Truss::mutationWeights + Truss::MUTATIONS ) ),
+      _schedulings( 1, MutationScheduler::FIXED ), _stopping( StoppingPolicy::timeOnly( 0.0 ) ), _threads( 1 ), _concurrent( 0 )
+{
+}
+
+bool            Batch::parse( int argc, char** argv, std::string& error )
+{
+    if( argc < 1 || argv[0][0] == '-' )
+    {
+        error = "The file to write the results to must come first";
+        return false;
+    }
+    _output = argv[0];
+
+    for( int i = 1; i < argc; i += 2 )
+    {
+        std::string option = argv[i];
+        if( i + 1 >= argc )
+        {
+            error = option + " needs a value";
+            return false;
+        }
+        std::string value = argv[i + 1];
+
+        bool valid;
+        if( option == "--seeds" )
+            valid = toSeeds( value, _seeds );
+        else if( option == "--time" )
+            valid = toList( value, _times );
+        else if( option == "--family" )
+            valid = toList( value, _familySizes ) && std::find( _familySizes.begin(), _familySizes.end(), 0u ) == _familySizes.end();
+        else if( option == "--intensity" )
+            valid = toList( value, _intensities );
+        else if( option == "--mutations" )
+        {
+            std::vector<std::string> sets = split( value, ',' );
+            _mutationWeights.clear();
+            valid = true;
+            for( auto set = sets.begin(); valid && set != sets.end(); ++set )
+            {
+                std::vector<std::string> parts = split( *set, ':' );
+                std::vector<unsigned int> weights( Truss::MUTATIONS );
+
+                valid = parts.size() == Truss::MUTATIONS;
+                for( unsigned int m = 0; valid && m < Truss::MUTATIONS; ++m )
+                    valid = toNumber( parts[m], weights[m] );
+
+                _mutationWeights.push_back( weights );
+            }
+        }
+        else if( option == "--scheduler" )
+            valid = toList( value, _schedulings );
+        else if( option == "--generations" )
+            valid = toNumber( value, _stopping.generations );
+        else if( option == "--evaluations" )
+            valid = toNumber( value, _stopping.evaluations );
+        else if( option == "--stagnation" )
+            valid = toNumber( value, _stopping.stagnation );
+        else if( option == "--epsilon" )
+            valid = toNumber( value, _stopping.epsilon ) && _stopping.epsilon >= 0.0;
+        else if( option == "--target" )
+            valid = toNumber( value, _stopping.target );
+        else if( option == "--threads" )
+            valid = toNumber( value, _threads ) && _threads > 0;
+        else if( option == "--concurrent" )
+            valid = toNumber( value, _concurrent );
+        else
+        {
+            error = "Unknown option " + option;
+            return false;
+        }
+
+        if( !valid )
+        {
+            error = "Could not use " + value + " for " + option;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<BatchJob>   Batch::jobs() const
+{
+    std::vector<BatchJob> jobs;
+
+    // The seeds go innermost, so that the runs of each combination of settings sit together
+    for( auto time = _times.begin(); time != _times.end(); ++time )
+    for( auto familySize = _familySizes.begin(); familySize != _familySizes.end(); ++familySize )
+    for( auto intensity = _intensities.begin(); intensity != _intensities.end(); ++intensity )
+    for( auto weights = _mutationWeights.begin(); weights != _mutationWeights.end(); ++weights )
+    for( auto scheduling = _schedulings.begin(); scheduling != _schedulings.end(); ++scheduling )
+    for( auto seed = _seeds.begin(); seed != _seeds.end(); ++seed )
+    {
+        BatchJob job;
+        job.seed = *seed;
+        job.stopping = _stopping;
+        job.stopping.seconds = *time;
+        job.familySize = *familySize;
+        job.fitnessIntensity = *intensity;
+        std::copy( weights->begin(), weights->end(), job.mutationWeights );
+        job.scheduling = *scheduling;
+        job.threads = _threads;
+
+        jobs.push_back( job );
+    }
+
+    return jobs;
+}
+
+bool            Batch::run( const Run& body ) const
+{
+    std::vector<BatchJob> jobs = this->jobs();
+
+    FILE* file = fopen( _output.c_str(), "w" );
+    if( file == nullptr )
+        return false;
+
+    bool written = fprintf( file, "run,seed,time,family,intensity,mutations,scheduler,threads,status,generations,fitness,max_force,sticks,time_to_best,stopped,evaluations\n" ) > 0;
+    fflush( file );
+
+    size_t finished = 0;
+    auto report = [&]( size_t index, const BatchRecord* record )
+    {
+        written = write( file, index, jobs[index], record ) && written;
+        fflush( file );
+
+        fprintf( stderr, "Run %zu of %zu %s (seed %llu)\n", ++finished, jobs.size(), record != nullptr ? "done" : "FAILED", (unsigned long long)jobs[index].seed );
+    };
+
+#ifndef _WIN32
+    unsigned int concurrent = _concurrent != 0 ? _concurrent : std::max( std::thread::hardware_concurrency() / _threads, 1u );
+
+    struct Running
+    {
+        pid_t       pid;
+        int         result;     // The end of the pipe the record comes back through
+        size_t      index;
+    };
+    std::vector<Running> running;
+    size_t next = 0;
+
+    // Nothing buffered may be written out twice by the children
+    fflush( stdout );
+    fflush( stderr );
+
+    while( next < jobs.size() || !running.empty() )
+    {
+        while( running.size() < concurrent && next < jobs.size() )
+        {
+            int ends[2];
+            if( pipe( ends ) != 0 )
+                throw std::runtime_error( "Error: Could not create a pipe for a batch run" );
+
+            pid_t pid = fork();
+            if( pid < 0 )
+                throw std::runtime_error( "Error: Could not start a batch run" );
+
+            if( pid == 0 )
+            {
+                close( ends[0] );
+
+                int status = 1;
+                try
+                {
+                    BatchRecord record = body( jobs[next] );
+                    if( ::write( ends[1], &record, sizeof( record ) ) == (ssize_t)sizeof( record ) )
+                        status = 0;
+                }
+                catch( const std::exception& e )
+                {
+                    fprintf( stderr, "%s\n", e.what() );
+                }
+                _exit( status );
+            }
+
+            close( ends[1] );
+
+            Running run = { pid, ends[0], next++ };
+            running.push_back( run );
+        }
+
+        int status;
+        pid_t pid = waitpid( -1, &status, 0 );
+        if( pid < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            throw std::runtime_error( "Error: Lost track of the batch runs" );
+        }
+
+        auto run = std::find_if( running.begin(), running.end(), [pid]( const Running& r ){ return r.pid == pid; } );
+        if( run == running.end() )
+            continue;
+
+        // The record is far smaller than a pipe holds, so it went in whole before the run exited
+        BatchRecord record;
+        bool succeeded = WIFEXITED( status ) && WEXITSTATUS( status ) == 0 && read( run->result, &record, sizeof( record ) ) == (ssize_t)sizeof( record );
+        close( run->result );
+
+        report( run->index, succeeded ? &record : nullptr );
+        running.erase( run );
+    }
+#else
+    // Runs share the process, so they have to take turns
+    for( size_t i = 0; i < jobs.size(); ++i )
+    {
+        try
+        {
+            BatchRecord record = body( jobs[i] );
+            report( i, &record );
+        }
+        catch( const std::exception& e )
+        {
+            fprintf( stderr, "%s\n", e.what() );
+            report( i, nullptr );
+        }
+    }
+#endif
+
+    return fclose( file ) == 0 && written;
+}
+
+bool            Batch::write( FILE* file, size_t index, const BatchJob& job, const BatchRecord* record ) const
+{
+    std::string weights;
+    for( unsigned int i = 0; i < Truss::MUTATIONS; ++i )
+        weights += (i == 0 ? "" : ":") + std::to_string( job.mutationWeights[i] );
+
+    int result = fprintf( file, "%zu,%llu,%g,%u,%g,%s,%s,%u,", index, (unsigned long long)job.seed, job.stopping.seconds, job.familySize, job.fitnessIntensity, weights.c_str(),
+                          SCHEDULINGS[job.scheduling], job.threads );
+
+    if( record == nullptr )
+        result = result > 0 ? fprintf( file, "failed,,,,,,,\n" ) : result;
+    else if( result > 0 )
+        result = fprintf( file, "ok,%llu,%.17g,%.17g,%g,%.3f,%s,%llu\n", (unsigned long long)record->generations, record->fitness, record->maxForce, record->sticks, record->timeToBest,
+                          StoppingPolicy::name( record->stopped ), (unsigned long long)record->evaluations );
+
+    return result > 0;
+}
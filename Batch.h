@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "Truss.h"
+#include "Scheduler.h"
+#include "Stopping.h"
+
+// The settings of one run in a batch
+struct BatchJob
+{
+    uint64_t        seed;
+    StoppingPolicy::Limits  stopping;   // The seconds from --time, everything else the same for the whole batch
+    unsigned int    familySize;
+    double          fitnessIntensity;
+    unsigned int    mutationWeights[Truss::MUTATIONS];
+    MutationScheduler::Mode scheduling;
+    unsigned int    threads;
+};
+
+// What one run of a batch found. Plain data, so that it can be passed back from another process as it is.
+struct BatchRecord
+{
+    uint64_t        generations;
+    double          fitness;
+    double          maxForce;       // The load the fittest design can carry
+    double          sticks;
+    double          timeToBest;     // Seconds into the run that the fittest design was found
+    StoppingPolicy::Reason  stopped;
+    uint64_t        evaluations;
+};
+
+// Runs every seed against every combination of the settings given, without ever waiting on the console.
+// Runs are independent jobs, each in a process of its own (one after another on Windows) with its own share of
+//  threads, and as many of them go at once as there are hardware threads to go round. Each result is added to a
+//  CSV file as soon as its run is done.
+class Batch
+{
+public:
+    typedef std::function<BatchRecord( const BatchJob& job )>   Run;
+public:
+    Batch();
+
+    // Reads the arguments that follow --batch. Returns false, with the reason in error, if they can not be used.
+    bool            parse( int argc, char** argv, std::string& error );
+    // Every seed with every combination of the settings, in the order they are run
+    std::vector<BatchJob>   jobs() const;
+
+    // Returns false if the results could not be written
+    bool            run( const Run& body ) const;
+
+    static const char*  USAGE;
+private:
+    // Runs are numbered by their place in jobs(), as they finish in whatever order they like
+    bool            write( FILE* file, size_t index, const BatchJob& job, const BatchRecord* record ) const;
+
+    std::string                 _output;
+    std::vector<uint64_t>       _seeds;
+    std::vector<double>         _times;
+    std::vector<unsigned int>   _familySizes;
+    std::vector<double>         _intensities;
+    // Each a full set of Truss::MUTATIONS weights
+    std::vector<std::vector<unsigned int>>  _mutationWeights;
+    std::vector<MutationScheduler::Mode>    _schedulings;
+    // Every limit on a run other than its time
+    StoppingPolicy::Limits      _stopping;
+    unsigned int                _threads;
+    unsigned int                _concurrent;
+};
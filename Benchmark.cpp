@@ -0,0 +1,347 @@
+// Fixed-input benchmarks of the truss kernels and of whole generations, written out as JSON so that versions can be
+//  compared. Build the truss_bench target from CMakeLists.txt.
+//
+// Usage: truss_bench [output.json] [--filter text] [--threads n] [--time seconds]
+// Every benchmark whose name contains the filter text is run for about the given time (0.5s by default) in a few
+//  batches. The fastest batch is kept, as the least disturbed by anything else running at the same time.
+
+#include "Genetic.h"
+#include "Truss.h"
+#include "PackedTruss.h"
+#include "Mutations.h"
+#include "Examples.h"
+#include "TrussBatch.h"
+#include "Allocations.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace
+{
+    const unsigned int  BATCHES = 5;
+
+    struct Result
+    {
+        std::string     name;
+        uint64_t        iterations;
+        double          nanoseconds;    // Per iteration, in the fastest batch
+        double          median;         // Per iteration, in the median batch
+        double          allocations;    // Per iteration, over every batch
+    };
+
+    struct Options
+    {
+        const char*     output;
+        const char*     filter;
+        unsigned int    threads;
+        double          time;
+    };
+
+    // Names of TrussBatch::Instructions
+    const char* const   INSTRUCTIONS[] = { "scalar", "avx2", "avx512" };
+
+    // Kept somewhere the optimiser can not see through, so that nothing being timed is thrown away
+    volatile double     sink;
+
+    typedef std::function<void( uint64_t iteration )>   Body;
+
+    double      seconds( std::chrono::steady_clock::time_point start )
+    {
+        return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    }
+
+    class Benchmarks
+    {
+    public:
+        explicit Benchmarks( const Options& options )
+            : _options( options )
+        {
+        }
+
+        // Runs body over and over, with an iteration count that keeps on going up
+        void        run( const std::string& name, const Body& body )
+        {
+            if( _options.filter != nullptr && name.find( _options.filter ) == std::string::npos )
+                return;
+
+            // Work out how many iterations fill a batch
+            uint64_t iterations = 1;
+            double batch = _options.time / BATCHES;
+            for( ;; )
+            {
+                auto start = std::chrono::steady_clock::now();
+                for( uint64_t i = 0; i < iterations; ++i )
+                    body( i );
+
+                double taken = seconds( start );
+                if( taken > batch / 4 || iterations >= (1ull << 40) )
+                {
+                    iterations = std::max<uint64_t>( 1, (uint64_t)(iterations * batch / std::max( taken, 1e-9 )) );
+                    break;
+                }
+                iterations *= 4;
+            }
+
+            std::vector<double> times;
+            uint64_t allocations = Allocations::count();
+            uint64_t iteration = 0;
+
+            for( unsigned int b = 0; b < BATCHES; ++b )
+            {
+                auto start = std::chrono::steady_clock::now();
+                for( uint64_t i = 0; i < iterations; ++i )
+                    body( iteration++ );
+
+                times.push_back( seconds( start ) * 1e9 / iterations );
+            }
+
+            std::sort( times.begin(), times.end() );
+
+            Result result = { name, iterations * BATCHES, times.front(), times[BATCHES / 2], (double)(Allocations::count() - allocations) / (iterations * BATCHES) };
+            _results.push_back( result );
+
+            fprintf( stderr, "%-48s %14.1f ns %10.2f allocations\n", name.c_str(), result.nanoseconds, result.allocations );
+        }
+
+        bool        write() const
+        {
+            FILE* file = _options.output == nullptr ? stdout : fopen( _options.output, "w" );
+            if( file == nullptr )
+                return false;
+
+            fprintf( file, "{\n  \"context\": { \"threads\": %u, \"solver\": \"%s\", \"instructions\": \"%s\", \"batches\": %u },\n  \"benchmarks\": [\n",
+                _options.threads, Truss::solver == Truss::EQUILIBRIUM_MATRIX ? "equilibrium matrix" : "method of joints", INSTRUCTIONS[TrussBatch::supported()], BATCHES );
+
+            for( size_t i = 0; i < _results.size(); ++i )
+            {
+                const Result& r = _results[i];
+                fprintf( file, "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"median_ns_per_op\": %.3f, \"allocations_per_op\": %.3f }%s\n",
+                    r.name.c_str(), (unsigned long long)r.iterations, r.nanoseconds, r.median, r.allocations, i + 1 < _results.size() ? "," : "" );
+            }
+
+            fprintf( file, "  ]\n}\n" );
+
+            return file == stdout || fclose( file ) == 0;
+        }
+    private:
+        Options             _options;
+        std::vector<Result> _results;
+    };
+
+    // Every iteration works on a fresh copy, as a truss remembers its last solve. The copy is timed separately.
+    void        kernels( Benchmarks& benchmarks )
+    {
+        struct Design
+        {
+            const char*     name;
+            Truss           truss;
+        } designs[] =
+        {
+            { "exa", Examples::exa() },
+            { "exb", Examples::exb() },
+            { "prebuilt", Examples::prebuilt() }
+        };
+
+        for( auto d = std::begin( designs ); d != std::end( designs ); ++d )
+        {
+            const Truss& design = d->truss;
+            std::string suffix = std::string( "/" ) + d->name;
+            Truss truss;
+
+            benchmarks.run( "Truss copy" + suffix, [&]( uint64_t )
+            {
+                Truss copy( design );
+                sink = copy.thicknessSum;
+            } );
+            benchmarks.run( "Truss::fitness" + suffix, [&]( uint64_t )
+            {
+                truss = design;
+                sink = truss.fitness();
+            } );
+
+            // Against the one above, what each load case adds
+            Truss::loadCases = { { { { 0.25, 1.0 } } }, { { { 0.75, 1.0 } } }, Truss::LoadCase::distributed( 0.0, 1.0, 2.0, 9 ),
+                                 Truss::LoadCase::distributed( 0.25, 0.75, 1.0, 5 ) };
+            benchmarks.run( "Truss::fitness 4 load cases" + suffix, [&]( uint64_t )
+            {
+                truss = design;
+                sink = truss.fitness();
+            } );
+            Truss::loadCases.clear();
+
+            PackedTruss packed( design );
+            benchmarks.run( "PackedTruss::pack" + suffix, [&]( uint64_t )
+            {
+                packed.pack( design );
+                sink = (double)packed.bytes();
+            } );
+            benchmarks.run( "PackedTruss::unpack" + suffix, [&]( uint64_t )
+            {
+                packed.unpack( truss );
+                sink = truss.thicknessSum;
+            } );
+            benchmarks.run( "Truss::calculateSafeties" + suffix, [&]( uint64_t )
+            {
+                truss = design;
+                sink = truss.calculateSafeties( truss.findMiddle() ).front().maxForce;
+            } );
+
+            Random::Generator random( 1 );
+            const struct
+            {
+                const char*         name;
+                Truss::Mutation*    mutation;
+            } mutations[] =
+            {
+                { "addNode", addNode },
+                { "removeNode", removeNode },
+                { "moveNode", moveNode },
+                { "thicken", thicken }
+            };
+
+            for( auto m = std::begin( mutations ); m != std::end( mutations ); ++m )
+            {
+                benchmarks.run( std::string( m->name ) + suffix, [&]( uint64_t i )
+                {
+                    Random::Generator stream = random.split( i );
+                    truss = design;
+                    m->mutation( &truss, stream );
+                    sink = truss.thicknessSum;
+                } );
+            }
+        }
+
+        Truss exa = Examples::exa();
+        Truss exb = Examples::exb();
+        Random::Generator random( 2 );
+        Truss child;
+
+        benchmarks.run( "Truss::create/exa x exb", [&]( uint64_t i )
+        {
+            Random::Generator stream = random.split( i );
+            child.create( exa, exb, (i & 1) != 0, stream );
+            sink = child.thicknessSum;
+        } );
+    }
+
+    // Evaluates GRAIN trusses at a time from a population that has had time to settle on a few topologies, with each
+    //  instruction set the batched solve can use
+    void        evaluation( Benchmarks& benchmarks )
+    {
+        const unsigned int GRAIN = GeneticAlgorithm<Truss>::GRAIN;
+
+        Truss exa = Examples::exa();
+        Truss exb = Examples::exb();
+
+        GeneticAlgorithm<Truss> algorithm;
+        algorithm.init( 2000, exa, 2000, exb );
+        algorithm.seed( 4 );
+        for( unsigned int i = 0; i < 200; ++i )
+            algorithm.process();
+
+        // Going through write and read leaves them with no solve to fall back on
+        std::vector<Truss> population( algorithm.family.size() );
+        for( size_t i = 0; i < population.size(); ++i )
+        {
+            std::vector<char> message;
+            algorithm.family[i].item.write( message );
+            const char* in = message.data();
+            population[i].read( in, message.data() + message.size() );
+        }
+
+        std::vector<Truss> trusses( GRAIN );
+        std::vector<Truss*> pointers( GRAIN );
+        std::vector<double> fitness( GRAIN );
+        for( unsigned int i = 0; i < GRAIN; ++i )
+            pointers[i] = &trusses[i];
+
+        TrussBatch::Instructions supported = TrussBatch::supported();
+
+        for( int set = TrussBatch::SCALAR; set <= supported; ++set )
+        {
+            TrussBatch::instructions = (TrussBatch::Instructions)set;
+
+            benchmarks.run( "Truss::evaluate " + std::to_string( GRAIN ) + "/" + INSTRUCTIONS[set], [&]( uint64_t i )
+            {
+                size_t start = (size_t)(i * GRAIN) % (population.size() - GRAIN);
+                std::copy( population.begin() + start, population.begin() + start + GRAIN, trusses.begin() );
+
+                Truss::evaluate( pointers.data(), GRAIN, fitness.data() );
+                sink = fitness.front();
+            } );
+        }
+
+        TrussBatch::instructions = supported;
+    }
+
+    // With the family kept as Genome, Truss or PackedTruss, and each generation made the given way
+    template <typename Genome>
+    void        generations( Benchmarks& benchmarks, unsigned int threads, typename GeneticAlgorithm<Genome>::Mode mode, const std::string& name )
+    {
+        const unsigned int sizes[] = { 1000, 10000, 100000 };
+
+        for( auto size = std::begin( sizes ); size != std::end( sizes ); ++size )
+        {
+            Genome exa( Examples::exa() );
+            Genome exb( Examples::exb() );
+
+            GeneticAlgorithm<Genome> algorithm;
+            algorithm.init( *size / 2, exa, *size / 2, exb );
+            algorithm.setThreads( threads );
+            algorithm.setFitnessCache( 1 << 20 );
+            algorithm.setMode( mode, 3 );
+            algorithm.seed( 3 );
+
+            // Let the family spread out from the two designs first, which is more like a real run
+            for( unsigned int i = 0; i < 5; ++i )
+                algorithm.process();
+
+            benchmarks.run( name + "::process/" + std::to_string( *size ), [&]( uint64_t )
+            {
+                algorithm.process();
+                sink = algorithm.family.front().fitness;
+            } );
+        }
+    }
+}
+
+int main( int argc, char** argv )
+{
+    Options options = { nullptr, nullptr, 1, 0.5 };
+
+    for( int i = 1; i < argc; ++i )
+    {
+        if( strcmp( argv[i], "--filter" ) == 0 && i + 1 < argc )
+            options.filter = argv[++i];
+        else if( strcmp( argv[i], "--threads" ) == 0 && i + 1 < argc )
+            options.threads = (unsigned int)atoi( argv[++i] );
+        else if( strcmp( argv[i], "--time" ) == 0 && i + 1 < argc )
+            options.time = atof( argv[++i] );
+        else
+            options.output = argv[i];
+    }
+
+    if( options.threads == 0 )
+        options.threads = std::max( std::thread::hardware_concurrency(), 1u );
+
+    Benchmarks benchmarks( options );
+
+    kernels( benchmarks );
+    evaluation( benchmarks );
+    generations<Truss>( benchmarks, options.threads, GeneticAlgorithm<Truss>::GENERATIONAL, "GeneticAlgorithm" );
+    generations<Truss>( benchmarks, options.threads, GeneticAlgorithm<Truss>::STEADY_STATE, "GeneticAlgorithm<steady state>" );
+    generations<PackedTruss>( benchmarks, options.threads, GeneticAlgorithm<PackedTruss>::GENERATIONAL, "GeneticAlgorithm<PackedTruss>" );
+
+    if( !benchmarks.write() )
+    {
+        fprintf( stderr, "Could not write the results to %s\n", options.output );
+        return 1;
+    }
+    return 0;
+}
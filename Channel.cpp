@@ -0,0 +1,131 @@
+#include "Channel.h"
+
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+bool    LocalChannel::send( const std::vector<char>& message )
+{
+    {
+        std::lock_guard<std::mutex> lock( _lock );
+        if( _closed )
+            return false;
+
+        _messages.push_back( message );
+    }
+    _arrived.notify_one();
+
+    return true;
+}
+bool    LocalChannel::receive( std::vector<char>& message )
+{
+    std::unique_lock<std::mutex> lock( _lock );
+    _arrived.wait( lock, [this]{ return !_messages.empty() || _closed; } );
+
+    if( _messages.empty() )
+        return false;
+
+    message = std::move( _messages.front() );
+    _messages.pop_front();
+
+    return true;
+}
+void    LocalChannel::close()
+{
+    {
+        std::lock_guard<std::mutex> lock( _lock );
+        _closed = true;
+    }
+    _arrived.notify_all();
+}
+
+#ifndef _WIN32
+
+#ifndef MSG_NOSIGNAL
+// A peer that has gone should show up as a failed send, not kill us with SIGPIPE
+#define MSG_NOSIGNAL 0
+#endif
+
+static bool     sendAll( int socket, const char* data, size_t size )
+{
+    while( size > 0 )
+    {
+        ssize_t sent = ::send( socket, data, size, MSG_NOSIGNAL );
+        if( sent < 0 && errno == EINTR )
+            continue;
+        if( sent <= 0 )
+            return false;
+
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+static bool     receiveAll( int socket, char* data, size_t size )
+{
+    while( size > 0 )
+    {
+        ssize_t received = ::recv( socket, data, size, 0 );
+        if( received < 0 && errno == EINTR )
+            continue;
+        if( received <= 0 )
+            return false;
+
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+SocketChannel::SocketChannel( int socket )
+    : _socket( socket )
+{
+    _reader = std::thread( &SocketChannel::read, this );
+}
+SocketChannel::~SocketChannel()
+{
+    // Wakes the reader up if it is still waiting on the other end
+    ::shutdown( _socket, SHUT_RDWR );
+    _reader.join();
+
+    ::close( _socket );
+}
+
+bool    SocketChannel::send( const std::vector<char>& message )
+{
+    uint64_t size = message.size();
+
+    return sendAll( _socket, reinterpret_cast<const char*>( &size ), sizeof( size ) ) &&
+        sendAll( _socket, message.data(), message.size() );
+}
+bool    SocketChannel::receive( std::vector<char>& message )
+{
+    return _inbox.receive( message );
+}
+void    SocketChannel::close()
+{
+    ::shutdown( _socket, SHUT_WR );
+}
+void    SocketChannel::read()
+{
+    std::vector<char> message;
+    uint64_t size;
+
+    while( receiveAll( _socket, reinterpret_cast<char*>( &size ), sizeof( size ) ) )
+    {
+        message.resize( (size_t)size );
+        if( !receiveAll( _socket, message.data(), message.size() ) )
+            break;
+
+        _inbox.send( message );
+    }
+
+    _inbox.close();
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// One direction of a link between two populations, carrying whole messages in the order they were sent
+class Channel
+{
+public:
+    virtual ~Channel()
+    {
+    }
+
+    // Returns false if the receiving end has gone, in which case the message is dropped
+    virtual bool    send( const std::vector<char>& message ) = 0;
+    // Blocks until a message arrives. Returns false once the sending end has closed and every message has been taken.
+    virtual bool    receive( std::vector<char>& message ) = 0;
+    // Tells the receiving end that nothing more is coming
+    virtual void    close() = 0;
+};
+
+// Both ends in the same process: a queue between two threads. Stands in for the sockets when testing.
+class LocalChannel : public Channel
+{
+public:
+    LocalChannel()
+        : _closed( false )
+    {
+    }
+
+    bool            send( const std::vector<char>& message );
+    bool            receive( std::vector<char>& message );
+    void            close();
+private:
+    std::mutex                      _lock;
+    std::condition_variable         _arrived;
+    std::deque<std::vector<char>>   _messages;
+    bool                            _closed;
+};
+
+#ifndef _WIN32
+// One end of a stream socket, such as either end of a Unix domain socketpair, used in one direction.
+// Messages go out with their length in front. A thread reads whatever arrives straight into a local queue, so
+//  that two processes sending to each other at the same time never stall on full socket buffers.
+class SocketChannel : public Channel
+{
+public:
+    // Takes ownership of the socket
+    explicit SocketChannel( int socket );
+    ~SocketChannel();
+
+    SocketChannel( const SocketChannel& ) = delete;
+    SocketChannel& operator =( const SocketChannel& ) = delete;
+
+    bool            send( const std::vector<char>& message );
+    bool            receive( std::vector<char>& message );
+    void            close();
+private:
+    void            read();
+
+    int             _socket;
+    LocalChannel    _inbox;
+    std::thread     _reader;
+};
+#endif
@@ -0,0 +1,140 @@
+#include "Counters.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    const char* const   NAMES[Counters::COUNTERS] =
+    {
+        "evaluations",
+        "rejected_determinancy",
+        "rejected_thickness",
+        "rejected_span",
+        "rejected_lowest",
+        "rejected_no_middle",
+        "solves",
+        "solve_passes",
+        "pass_cap_hits",
+        "unsolvable",
+        "creates",
+        "reconnection_passes",
+        "add_node",
+        "add_node_unchanged",
+        "remove_node",
+        "remove_node_unchanged",
+        "thicken",
+        "thicken_unchanged",
+        "move_node",
+        "move_node_unchanged",
+    };
+
+    // Only the owning thread writes, the atomics just let total() read while it does
+    struct Slot
+    {
+        std::atomic<uint64_t>   values[Counters::COUNTERS];
+        // Keeps the next slot on the heap off the last cache line of this one, so that threads do not fight over it
+        char                    padding[64];
+    };
+
+    struct Registry
+    {
+        std::mutex              lock;
+        std::vector<Slot*>      slots;
+        std::vector<Slot*>      unused;     // Left by threads that have ended, still counting towards the total
+
+        Slot*       acquire()
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            if( !unused.empty() )
+            {
+                Slot* slot = unused.back();
+                unused.pop_back();
+                return slot;
+            }
+
+            Slot* slot = new Slot();
+            for( unsigned int i = 0; i < Counters::COUNTERS; ++i )
+                slot->values[i].store( 0, std::memory_order_relaxed );
+
+            slots.push_back( slot );
+            return slot;
+        }
+        void        release( Slot* slot )
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            unused.push_back( slot );
+        }
+    };
+
+    // Never destroyed, as threads can still be ending while the statics are torn down
+    Registry&   registry()
+    {
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    struct Owner
+    {
+        Owner()
+            : slot( registry().acquire() )
+        {
+        }
+        ~Owner()
+        {
+            registry().release( slot );
+        }
+
+        Slot*       slot;
+    };
+    thread_local Owner          owner;
+}
+
+void        Counters::add( Counter counter, uint64_t amount )
+{
+    std::atomic<uint64_t>& value = owner.slot->values[counter];
+    value.store( value.load( std::memory_order_relaxed ) + amount, std::memory_order_relaxed );
+}
+
+Counters::Counts    Counters::Counts::since( const Counts& earlier ) const
+{
+    Counts difference;
+    for( unsigned int i = 0; i < COUNTERS; ++i )
+        difference.values[i] = values[i] - earlier.values[i];
+    return difference;
+}
+
+Counters::Counts    Counters::total()
+{
+    Counts counts = {};
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard( r.lock );
+    for( auto slot = r.slots.begin(); slot != r.slots.end(); ++slot )
+    {
+        for( unsigned int i = 0; i < COUNTERS; ++i )
+            counts.values[i] += (*slot)->values[i].load( std::memory_order_relaxed );
+    }
+    return counts;
+}
+
+const char* Counters::name( Counter counter )
+{
+    return NAMES[counter];
+}
+
+void        Counters::writeHeader( std::ostream& out )
+{
+    out << "generation";
+    for( unsigned int i = 0; i < COUNTERS; ++i )
+        out << ',' << NAMES[i];
+    out << '\n';
+}
+void        Counters::writeRow( std::ostream& out, uint64_t generation, const Counts& counts )
+{
+    out << generation;
+    for( unsigned int i = 0; i < COUNTERS; ++i )
+        out << ',' << counts.values[i];
+    out << '\n';
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <ostream>
+
+// Counts of what the hot paths run into, always on. Each thread counts into a slot of its own, so counting is a
+//  plain add, and a slot is handed on to the next thread once its thread ends so that nothing counted is lost.
+namespace Counters
+{
+    enum Counter
+    {
+        // Trusses handed to Truss::fitness or Truss::evaluate (not those whose fitness came from the cache), and
+        //  those turned away before solving, by the first check they failed
+        EVALUATIONS,
+        REJECTED_DETERMINANCY,      // Not exactly as many members as a determinate truss needs
+        REJECTED_THICKNESS,         // More than 23 sticks
+        REJECTED_SPAN,              // The ends too close together or too far apart
+        REJECTED_LOWEST,            // A node below -135
+        REJECTED_NO_MIDDLE,         // No node to hang the load from
+
+        // Member forces worked out, and the passes over the joints the method of joints took for them. A solve that
+        //  follows a SolvePlan counts the passes the plan took.
+        SOLVES,
+        SOLVE_PASSES,
+        PASS_CAP_HITS,              // Used every one of MAXIMUM_CALCULATION_PASSES without resolving every joint
+        UNSOLVABLE,                 // Every force left at DBL_MAX, by either solver
+
+        CREATES,
+        RECONNECTION_PASSES,        // Passes Truss::create made looking for members to add
+
+        // Each mutation, followed by how many of those calls left the truss as it was
+        ADD_NODE,
+        ADD_NODE_UNCHANGED,
+        REMOVE_NODE,
+        REMOVE_NODE_UNCHANGED,
+        THICKEN,
+        THICKEN_UNCHANGED,
+        MOVE_NODE,
+        MOVE_NODE_UNCHANGED,
+
+        COUNTERS
+    };
+
+    struct Counts
+    {
+        uint64_t    values[COUNTERS];
+
+        uint64_t    operator []( Counter counter ) const
+        {
+            return values[counter];
+        }
+        // What was counted between earlier and these
+        Counts      since( const Counts& earlier ) const;
+    };
+
+    void            add( Counter counter, uint64_t amount = 1 );
+
+    // Everything counted by every thread since the program started
+    Counts          total();
+    // Lower case, as the CSV columns are named
+    const char*     name( Counter counter );
+
+    // A CSV file of counts, one line per generation
+    void            writeHeader( std::ostream& out );
+    void            writeRow( std::ostream& out, uint64_t generation, const Counts& counts );
+}
@@ -0,0 +1,213 @@
+#include "Equilibrium.h"
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+// Pivots smaller than this mean the truss can move without any member resisting, i.e. it is a mechanism.
+// Every entry is a component of a unit vector, so no scaling is needed.
+const double SINGULAR_PIVOT = 1e-10;
+
+bool    Equilibrium::factorise( const NodeList& nodes, const Connections& connections )
+{
+    unsigned int count = (unsigned int)nodes.size();
+
+    _members = (unsigned int)connections.size();
+    _size = 0;
+
+    if( count < 2 || _members + 3 != 2 * count )
+        return false;
+
+    Vector tilt = nodes.back() - nodes.front();
+    double span = tilt.length();
+
+    if( span < DBL_EPSILON )
+        return false;
+
+    tilt.x /= span;
+    tilt.y /= span;
+
+    // As in the method of joints, gravity is orthogonal to the line between the supports
+    _gravity = Vector( tilt.y, -tilt.x );
+
+    // Columns: the two left reactions, then the members, then the right reaction.
+    // Work out how far below and above the diagonal the entries reach.
+    unsigned int size = 2 * count;
+    unsigned int lower = 0;
+    unsigned int upper = 1;
+    for( unsigned int m = 0; m < _members; ++m )
+    {
+        unsigned int column = m + 2;
+        unsigned int top = 2 * connections[m].a;
+        unsigned int bottom = 2 * connections[m].b + 1;
+
+        if( bottom > column )
+            lower = std::max( lower, bottom - column );
+        if( column > top )
+            upper = std::max( upper, column - top );
+    }
+
+    // Pivoting can push each row up to lower more entries past its upper band
+    _size = size;
+    _lower = lower;
+    _width = 2 * lower + upper + 1;
+    unsigned int reach = lower + upper;
+
+    _band.clear();
+    _band.resize( _size * _width, 0.0 );
+
+    for( unsigned int m = 0; m < _members; ++m )
+    {
+        const Connection& con = connections[m];
+        Vector direction = nodes[con.b] - nodes[con.a];
+        double length = direction.length();
+
+        if( length < DBL_EPSILON )
+        {
+            _size = 0;
+            return false;
+        }
+
+        // A member in tension pulls each of its ends toward the other
+        at( 2 * con.a, m + 2 ) = direction.x / length;
+        at( 2 * con.a + 1, m + 2 ) = direction.y / length;
+        at( 2 * con.b, m + 2 ) = -direction.x / length;
+        at( 2 * con.b + 1, m + 2 ) = -direction.y / length;
+    }
+
+    at( 0, 0 ) = 1.0;
+    at( 1, 1 ) = 1.0;
+    at( _size - 2, _size - 1 ) = _gravity.x;
+    at( _size - 1, _size - 1 ) = _gravity.y;
+
+    // Banded LU factorisation with partial pivoting. The multipliers are kept as a list of eliminations to replay,
+    //  rather than in the band, so that rows can be swapped without shifting them.
+    _pivots.resize( _size );
+    _steps.resize( _size );
+    _eliminations.clear();
+
+    for( unsigned int k = 0; k < _size; ++k )
+    {
+        unsigned int last = std::min( _size - 1, k + _lower );
+        unsigned int right = std::min( _size - 1, k + reach );
+
+        unsigned int pivot = k;
+        for( unsigned int r = k + 1; r <= last; ++r )
+        {
+            if( fabs( at( r, k ) ) > fabs( at( pivot, k ) ) )
+                pivot = r;
+        }
+
+        if( fabs( at( pivot, k ) ) < SINGULAR_PIVOT )
+        {
+            _size = 0;
+            return false;
+        }
+
+        _pivots[k] = pivot;
+        if( pivot != k )
+        {
+            for( unsigned int c = k; c <= right; ++c )
+                std::swap( at( k, c ), at( pivot, c ) );
+        }
+
+        for( unsigned int r = k + 1; r <= last; ++r )
+        {
+            if( at( r, k ) == 0.0 )
+                continue;
+
+            double factor = at( r, k ) / at( k, k );
+            _eliminations.push_back( { r, factor } );
+
+            for( unsigned int c = k + 1; c <= right; ++c )
+                at( r, c ) -= factor * at( k, c );
+        }
+
+        _steps[k] = (unsigned int)_eliminations.size();
+    }
+
+    return true;
+}
+
+void    Equilibrium::solve( const double* loads, double* forces ) const
+{
+    // The members and reactions have to cancel out the loads
+    InlineVector<double, 2 * INLINE_NODES> x( _size );
+    for( unsigned int i = 0; i < _size; ++i )
+        x[i] = -loads[i];
+
+    unsigned int e = 0;
+    for( unsigned int k = 0; k < _size; ++k )
+    {
+        std::swap( x[k], x[_pivots[k]] );
+
+        for( ; e < _steps[k]; ++e )
+            x[_eliminations[e].row] -= _eliminations[e].factor * x[k];
+    }
+
+    unsigned int reach = _width - _lower - 1;
+    for( int r = (int)_size - 1; r >= 0; --r )
+    {
+        unsigned int right = std::min( _size - 1, r + reach );
+        for( unsigned int c = r + 1; c <= right; ++c )
+            x[r] -= at( r, c ) * x[c];
+
+        x[r] /= at( r, r );
+    }
+
+    // The reactions either side are not needed
+    for( unsigned int m = 0; m < _members; ++m )
+        forces[m] = x[m + 2];
+}
+
+void    Equilibrium::solve( const double* loads, double* forces, unsigned int count ) const
+{
+    // The members and reactions have to cancel out the loads. The sets are interleaved, so that every step of the
+    //  substitution is done to all of them together.
+    InlineVector<double, 2 * INLINE_NODES * 8> x( _size * count );
+    for( unsigned int c = 0; c < count; ++c )
+    {
+        for( unsigned int i = 0; i < _size; ++i )
+            x[i * count + c] = -loads[c * _size + i];
+    }
+
+    unsigned int e = 0;
+    for( unsigned int k = 0; k < _size; ++k )
+    {
+        double* pivot = &x[k * count];
+        std::swap_ranges( pivot, pivot + count, &x[_pivots[k] * count] );
+
+        for( ; e < _steps[k]; ++e )
+        {
+            double* row = &x[_eliminations[e].row * count];
+            double factor = _eliminations[e].factor;
+            for( unsigned int c = 0; c < count; ++c )
+                row[c] -= factor * pivot[c];
+        }
+    }
+
+    unsigned int reach = _width - _lower - 1;
+    for( int r = (int)_size - 1; r >= 0; --r )
+    {
+        double* row = &x[r * count];
+        unsigned int right = std::min( _size - 1, r + reach );
+        for( unsigned int column = r + 1; column <= right; ++column )
+        {
+            double entry = at( r, column );
+            const double* known = &x[column * count];
+            for( unsigned int c = 0; c < count; ++c )
+                row[c] -= entry * known[c];
+        }
+
+        double diagonal = at( r, r );
+        for( unsigned int c = 0; c < count; ++c )
+            row[c] /= diagonal;
+    }
+
+    // The reactions either side are not needed
+    for( unsigned int c = 0; c < count; ++c )
+    {
+        for( unsigned int m = 0; m < _members; ++m )
+            forces[c * _members + m] = x[(m + 2) * count + c];
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Node.h"
+
+// The equilibrium equations of a whole truss, solved in one go instead of joint by joint.
+// There are two rows per node (the balance of forces in x then y) and one column per member, holding the
+//  direction that member pulls the node in when in tension. Three more columns hold the reactions: the left
+//  support is pinned (x and y), the right one rolls and can only push along gravity.
+// That makes the system square exactly when the truss is statically determinate. It is factorised once and can
+//  then be solved for any load.
+//
+// Nodes are sorted by x and members are at most MAX_MEMBER_LENGTH long, so every member only touches rows close
+//  to its own column (the left reactions go first and the right one last to keep it that way). The system is
+//  therefore stored and factorised as a band, which keeps the cost linear in the size of the truss.
+class Equilibrium
+{
+public:
+    Equilibrium()
+        : _size( 0 ), _members( 0 ), _lower( 0 ), _width( 0 )
+    {
+    }
+
+    // Builds and factorises the system. Returns false if the truss is not determinate, or is a mechanism
+    //  (the system is singular), in which case nothing can be solved.
+    bool            factorise( const NodeList& nodes, const Connections& connections );
+
+    // Solves for the member forces (positive in tension, ordered as the connections) under the given loads,
+    //  which hold an x and y force for every node.
+    void            solve( const double* loads, double* forces ) const;
+    // The same for count sets of loads at once, one after the other in loads, giving one set of forces after the
+    //  other. Each set after the first costs far less than solving it on its own would.
+    void            solve( const double* loads, double* forces, unsigned int count ) const;
+
+    // Whether the last factorise succeeded, so that solve can be used
+    bool            factorised() const
+    {
+        return _size != 0;
+    }
+
+    // The direction the loads act in, which is orthogonal to the line between the two supports
+    const Vector&   gravity() const
+    {
+        return _gravity;
+    }
+private:
+    // Row r keeps the columns from r - _lower up to r + _width - _lower - 1, which is room for every entry
+    //  the row can pick up through pivoting
+    double&         at( unsigned int row, unsigned int column )
+    {
+        return _band[row * _width + column + _lower - row];
+    }
+    double          at( unsigned int row, unsigned int column ) const
+    {
+        return _band[row * _width + column + _lower - row];
+    }
+
+    // One elimination done while factorising: row -= factor * (pivot row)
+    struct Elimination
+    {
+        unsigned int    row;
+        double          factor;
+    };
+
+    InlineVector<double, 2 * INLINE_NODES * 16>             _band;
+    // The row swapped into place at each step, and where that step's eliminations end in _eliminations
+    InlineVector<unsigned int, 2 * INLINE_NODES>            _pivots;
+    InlineVector<unsigned int, 2 * INLINE_NODES>            _steps;
+    InlineVector<Elimination, 2 * INLINE_NODES * 8>         _eliminations;
+
+    unsigned int    _size;
+    unsigned int    _members;
+    unsigned int    _lower;
+    unsigned int    _width;
+    Vector          _gravity;
+};
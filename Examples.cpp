@@ -0,0 +1,91 @@
+#include "Examples.h"
+
+#include <iterator>
+
+// The nodes are inserted in order of x, so the indices handed back stay valid
+
+Truss   Examples::exa()
+{
+    Truss exa;
+
+    auto a = exa.insert( Node( -231.0, 0.0 ) ).first;
+    auto b = exa.insert( Node( -112.5, 20.0 ) ).first;
+    auto c = exa.insert( Node( -100.0, -20.0 ) ).first;
+    auto d = exa.insert( Node( 0.0, -40.0 ) ).first;
+    auto e = exa.insert( Node( 10.0, 20.0 ) ).first;
+    auto f = exa.insert( Node( 100.0, -20.0 ) ).first;
+    auto g = exa.insert( Node( 112.5, 20.0 ) ).first;
+    auto h = exa.insert( Node( 231.0, 0.0 ) ).first;
+
+    exa.connect( a, b, 1.0 );
+    exa.connect( a, c, 1.0 );
+    exa.connect( b, e, 1.0 );
+    exa.connect( b, c, 1.0 );
+    exa.connect( c, d, 1.0 );
+    exa.connect( c, e, 1.0 );
+    exa.connect( d, e, 1.0 );
+    exa.connect( d, f, 1.0 );
+    exa.connect( e, f, 1.0 );
+    exa.connect( e, g, 1.0 );
+    exa.connect( f, g, 1.0 );
+    exa.connect( f, h, 1.0 );
+    exa.connect( g, h, 1.0 );
+
+    return exa;
+}
+Truss   Examples::exb()
+{
+    Truss exb;
+
+    auto a = exb.insert( Node( -232.0, 0.0 ) ).first;
+    auto b = exb.insert( Node( -160.0, -100.0 ) ).first;
+    auto c = exb.insert( Node( -105.0, 0.0 ) ).first;
+    auto d = exb.insert( Node( -0.0, -100.0 ) ).first;
+    auto e = exb.insert( Node( 30.0, 0.0 ) ).first;
+    auto f = exb.insert( Node( 130.0, -100.0 ) ).first;
+    auto g = exb.insert( Node( 165.0, 0.0 ) ).first;
+    auto h = exb.insert( Node( 232.0, 0.0 ) ).first;
+
+    exb.connect( a, b, 1.0 );
+    exb.connect( a, c, 1.0 );
+    exb.connect( b, c, 1.0 );
+    exb.connect( b, d, 1.0 );
+    exb.connect( c, d, 1.0 );
+    exb.connect( c, e, 1.0 );
+    exb.connect( d, e, 1.0 );
+    exb.connect( d, f, 1.0 );
+    exb.connect( e, f, 1.0 );
+    exb.connect( e, g, 1.0 );
+    exb.connect( f, g, 1.0 );
+    exb.connect( f, h, 1.0 );
+    exb.connect( g, h, 1.0 );
+
+    return exb;
+}
+Truss   Examples::prebuilt()
+{
+    const double positions[][2] =
+    {
+        { -222.178, -72.7495 }, { -126.676, 26.4312 }, { -108.739, -76.6456 }, { -54.7112, -69.7374 }, { -20.2883, 98.4952 },
+        { 3.74188, -41.4047 }, { 19.3737, 106.678 }, { 83.7433, -26.5924 }, { 135.631, 101.805 }, { 231.0, 0.0 }
+    };
+    const struct
+    {
+        NodeIndex   a;
+        NodeIndex   b;
+        double      thickness;
+    } members[] =
+    {
+        { 0, 1, 2.0 }, { 0, 2, 1.0 }, { 1, 2, 1.0 }, { 1, 3, 1.0 }, { 1, 4, 2.0 }, { 1, 5, 1.0 }, { 2, 3, 1.0 }, { 3, 7, 1.0 },
+        { 4, 5, 1.0 }, { 4, 6, 1.0 }, { 5, 6, 1.0 }, { 5, 7, 1.0 }, { 6, 7, 2.0 }, { 6, 8, 2.0 }, { 7, 8, 2.0 }, { 7, 9, 1.0 },
+        { 8, 9, 2.0 }
+    };
+
+    Truss prebuilt;
+    for( auto i = std::begin( positions ); i != std::end( positions ); ++i )
+        prebuilt.insert( Node( (*i)[0], (*i)[1] ) );
+    for( auto i = std::begin( members ); i != std::end( members ); ++i )
+        prebuilt.connect( i->a, i->b, i->thickness );
+
+    return prebuilt;
+}
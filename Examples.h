@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Truss.h"
+
+// Trusses that runs start from, and that the benchmarks use as fixed inputs
+namespace Examples
+{
+    // The two designs a run is started from, half the family each
+    Truss           exa();
+    Truss           exb();
+    // The 10 node, 23 stick design found by the prebuilt executable, see Prebuilt executable/TrussDesign_FS50k.txt
+    Truss           prebuilt();
+}
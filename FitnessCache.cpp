@@ -0,0 +1,44 @@
+#include "FitnessCache.h"
+
+FitnessCache::FitnessCache( size_t capacity )
+    : _locks( new std::mutex[SHARDS] )
+{
+    size_t size = 1;
+    while( size < capacity )
+        size *= 2;
+
+    _slots.resize( size, { 0, 0.0 } );
+    _mask = size - 1;
+}
+
+bool    FitnessCache::find( uint64_t key, double& fitness )
+{
+    key = usable( key );
+    size_t slot = (size_t)(key & _mask);
+
+    std::lock_guard<std::mutex> lock( shard( slot ) );
+    if( _slots[slot].key != key )
+        return false;
+
+    fitness = _slots[slot].fitness;
+    return true;
+}
+void    FitnessCache::insert( uint64_t key, double fitness )
+{
+    key = usable( key );
+    size_t slot = (size_t)(key & _mask);
+
+    std::lock_guard<std::mutex> lock( shard( slot ) );
+    _slots[slot] = { key, fitness };
+}
+void    FitnessCache::clear()
+{
+    for( unsigned int i = 0; i < SHARDS; ++i )
+        _locks[i].lock();
+
+    for( auto i = _slots.begin(); i != _slots.end(); ++i )
+        *i = { 0, 0.0 };
+
+    for( unsigned int i = 0; i < SHARDS; ++i )
+        _locks[i].unlock();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <memory>
+
+// A fixed size table from genome hashes to fitness, shared by every thread.
+// Each key maps to a single slot, and a newer entry simply replaces whatever was there before, so the table never
+//  grows past the capacity it was made with. The slots are split into shards with a lock each to keep threads apart.
+class FitnessCache
+{
+public:
+    // The capacity is rounded up to a power of two
+    FitnessCache( size_t capacity );
+
+    // Returns true and fills in fitness if the key is present
+    bool            find( uint64_t key, double& fitness );
+    void            insert( uint64_t key, double fitness );
+    void            clear();
+
+    size_t          capacity() const
+    {
+        return _slots.size();
+    }
+private:
+    static const unsigned int   SHARDS = 256;
+
+    struct Slot
+    {
+        uint64_t    key;
+        double      fitness;
+    };
+
+    std::mutex&     shard( size_t slot )
+    {
+        return _locks[slot % SHARDS];
+    }
+
+    // Key 0 marks an empty slot, so a genome that hashes to 0 is stored under 1 instead
+    static uint64_t usable( uint64_t key )
+    {
+        return key == 0 ? 1 : key;
+    }
+
+    std::vector<Slot>           _slots;
+    size_t                      _mask;
+    std::unique_ptr<std::mutex[]>   _locks;
+};
@@ -3,9 +3,20 @@
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include <math.h>
+#include <chrono>
+#include <thread>
 
 #include "Random.h"
 #include "GeneticItem.h"
+#include "ThreadPool.h"
+#include "FitnessCache.h"
+#include "Selection.h"
+#include "Scheduler.h"
+#include "Trace.h"
 
 template <typename CRTP>
 class GeneticAlgorithm
@@ -19,17 +30,148 @@ public:
         {
         }
         Item( CRTP i, Fitness f )
-            : item( i ), fitness( f )
+            : item( std::move( i ) ), fitness( f )
         {
         }
         CRTP                    item;
         Fitness                 fitness;
     };
 
-    typedef std::vector<std::pair<CRTP*, CRTP*>> GeneticPairs;
+    // Indices into the family, two per pair of parents
+    typedef std::vector<unsigned int> Parents;
+
+    struct CacheStatistics
+    {
+        uint64_t                hits;
+        uint64_t                misses;
+
+        double                  hitRate() const
+        {
+            return hits + misses == 0 ? 0.0 : (double)hits / (hits + misses);
+        }
+    };
+
+    // Number of individuals handed to a worker at a time. Small enough to balance, large enough to not fight over the queues.
+    static const unsigned int   GRAIN = 256;
+    // The same in steady state, where it is also how many children are evaluated together before going into the family
+    static const unsigned int   STEADY_GRAIN = 32;
+
+    // How each generation is made
+    enum Mode
+    {
+        GENERATIONAL,   // The whole family is selected from, then replaced by its children all at once
+        STEADY_STATE    // Children go back into the family as soon as they are evaluated, see steadyState()
+    };
+
+    // Every generation splits its own generator from the seed, and then one stream per phase from that.
+    // Recombination and mutation split again per pair and per individual, so the result does not depend on the thread count.
+    enum Stream
+    {
+        SELECTION_STREAM = 0,
+        RECOMBINATION_STREAM,
+        MUTATION_STREAM,
+        REPLACEMENT_STREAM      // Only used in steady state
+    };
 public:
+    GeneticAlgorithm()
+        : _generation( 0 ), _pool( new ThreadPool( 1 ) ), _selection( new UniversalSampling<Item>() ), _mode( GENERATIONAL ), _tournamentSize( 2 ), _lockCount( 0 ),
+          _cacheHits( 0 ), _cacheMisses( 0 ), _totalHits( 0 ), _totalMisses( 0 ), _evaluated( 0 ), _totalEvaluated( 0 )
+    {
+        _scheduler.reset( MutationScheduler::FIXED, CRTP::mutationWeights, CRTP::MUTATIONS );
+    }
+
     std::vector<Item>       family;
 
+    // Sets how many threads recombination and mutation are spread across. 0 uses every hardware thread.
+    void                setThreads( unsigned int threads )
+    {
+        _pool.reset( new ThreadPool( threads ) );
+    }
+    unsigned int        threads() const
+    {
+        return _pool->size();
+    }
+
+    // Takes ownership of the strategy that chooses parents, see Selection.h
+    void                setSelection( Selection<Item>* selection )
+    {
+        _selection.reset( selection );
+    }
+
+    // In STEADY_STATE parents are the fittest of tournamentSize items, and each child replaces the least fit of
+    //  another tournamentSize, so the strategy given to setSelection is not used
+    void                setMode( Mode mode, unsigned int tournamentSize )
+    {
+        _mode = mode;
+        _tournamentSize = std::max( tournamentSize, 1u );
+    }
+    Mode                mode() const
+    {
+        return _mode;
+    }
+
+    // Shares fitness between identical individuals (by CRTP::hash) through a table with room for the given number
+    //  of entries. 0 turns it off. Call again to start afresh if anything the fitness depends on changes.
+    void                setFitnessCache( size_t capacity )
+    {
+        _cache.reset( capacity == 0 ? nullptr : new FitnessCache( capacity ) );
+    }
+    // How each item's mutation is chosen, see Scheduler.h. ADAPTIVE starts from CRTP::mutationWeights as they are now.
+    void                setMutationScheduling( MutationScheduler::Mode mode )
+    {
+        _scheduler.reset( mode, CRTP::mutationWeights, CRTP::MUTATIONS );
+    }
+    const MutationScheduler&    scheduler() const
+    {
+        return _scheduler;
+    }
+
+    // Lookups made while evaluating the last generation
+    CacheStatistics     cacheStatistics() const
+    {
+        return { _cacheHits, _cacheMisses };
+    }
+    // Lookups made over every generation so far
+    CacheStatistics     totalCacheStatistics() const
+    {
+        return { _totalHits, _totalMisses };
+    }
+    // Items whose fitness has been worked out over every generation so far, not counting those the cache answered
+    uint64_t            evaluations() const
+    {
+        return _totalEvaluated;
+    }
+
+    void                seed( uint64_t s )
+    {
+        _random = Random::Generator( s );
+        _generation = 0;
+    }
+    // The seed given to seed(), which with the generation is all the random state there is
+    uint64_t            seedValue() const
+    {
+        return _random.key();
+    }
+    uint64_t            generation() const
+    {
+        return _generation;
+    }
+
+    // Carries on from a family restored from elsewhere (such as a snapshot), as though it had just been made by
+    //  the given generation of the given seed
+    void                resume( uint64_t seed, uint64_t generation )
+    {
+        _random = Random::Generator( seed );
+        _generation = generation;
+        _familySize = (unsigned int)family.size();
+    }
+
+    // The threads the algorithm runs on, free for anything else between generations
+    ThreadPool&         pool()
+    {
+        return *_pool;
+    }
+
     void				init( int familySize, CRTP& initial )
     {
 		_familySize = familySize;
@@ -39,6 +181,7 @@ public:
 		if (isinf(fitness))
 			throw std::runtime_error("Cannot start a genetic algorithm with an entirely defect population!");
 
+		family.clear();
 		family.resize(familySize, { initial, fitness } );
     }
     void				init( int copyA, CRTP& a, int copyB, CRTP& b )
@@ -48,103 +191,433 @@ public:
         double aFitness = a.fitness();
         double bFitness = b.fitness();
 
-        if( isinf( aFitness ) || isinf( aFitness ) )
+        if( isinf( aFitness ) || isinf( bFitness ) )
             throw std::runtime_error( "Cannot start a genetic algorithm with a defect population!" );
 
+        family.clear();
         family.resize( copyA, { a, aFitness } );
-        family.resize( copyB, { b, bFitness } );
+        family.resize( copyA + copyB, { b, bFitness } );
     }
     void				process()
     {
-        GeneticPairs pairs;
-        pairs = std::move( selection() );
-        std::vector<Item> newFamily = recombination( pairs );
+        TRACE_SPAN( "generation" );
 
-        family.clear();
-        std::swap( family, newFamily );
-        
-        pairs.clear();
+        Random::Generator random = _random.split( _generation++ );
 
-        mutate();
+        if( _mode == STEADY_STATE )
+        {
+            steadyState( random );
+            return;
+        }
+
+        Random::Generator selectionRandom = random.split( SELECTION_STREAM );
+
+        selection( selectionRandom );
+        recombination( random.split( RECOMBINATION_STREAM ) );
+
+        // The children become the family, and the old family is kept around to build the next generation in
+        std::swap( family, _offspring );
+
+        mutate( random.split( MUTATION_STREAM ) );
     }
 
     Item&				fittest()
     {
         return *std::max_element( family.begin(), family.end(), []( const Item& a, const Item& b ){ return a.fitness < b.fitness; } );
     }
+    const Item&         fittest() const
+    {
+        return *std::max_element( family.begin(), family.end(), []( const Item& a, const Item& b ){ return a.fitness < b.fitness; } );
+    }
+    Fitness             meanFitness() const
+    {
+        Fitness total = 0.0;
+        for( auto i = family.begin(); i != family.end(); ++i )
+            total += i->fitness;
+        return family.empty() ? 0.0 : total / family.size();
+    }
+
+    // Copies out the count fittest items, fittest first, to be sent to another population
+    void                emigrants( unsigned int count, std::vector<Item>& items ) const
+    {
+        std::vector<unsigned int> order = ranking( count, []( const Item& a, const Item& b ){ return a.fitness > b.fitness; } );
+
+        items.clear();
+        for( auto i = order.begin(); i != order.end(); ++i )
+            items.push_back( family[*i] );
+    }
+    // Replaces the least fit items with the ones given, which keeps the family the same size
+    void                immigrate( const std::vector<Item>& items )
+    {
+        std::vector<unsigned int> order = ranking( (unsigned int)items.size(), []( const Item& a, const Item& b ){ return a.fitness < b.fitness; } );
+
+        for( unsigned int i = 0; i < order.size(); ++i )
+            family[order[i]] = items[i];
+    }
 protected:
-    // Selects items and pairs them up
-    GeneticPairs		selection()
+    struct Evaluation;
+
+    // Selects items and pairs them up, enough to keep the family the size it started at
+    void                selection( Random::Generator& random )
     {
-        // Choose fitness
-        double average = std::accumulate( family.begin(), family.end(), 0.0, []( double init, const Item& item ){ return init + (double)item.fitness; } ) / family.size();
+        TRACE_SPAN( "selection" );
 
-        if( fabs( average ) < DBL_EPSILON )
-            throw std::runtime_error( "A fatal and impossible genetic defect has occured in the entire population." );
+        _selection->select( family, (_familySize / 2) * 2, random, *_pool, _parents );
+    }
+    // Builds the children into _offspring, over whatever was left there by the generation before last
+    void                recombination( const Random::Generator& streams )
+    {
+        TRACE_SPAN( "recombination" );
 
-        for( auto i = family.begin(); i != family.end(); ++i )
+        // Each pair writes only to its own two children, so the pairs can be split freely between threads
+        size_t pairs = _parents.size() / 2;
+
+        // Only grows the first time round (or after init or immigration changed the family size)
+        _offspring.resize( pairs * 2 );
+
+        _pool->parallelFor( pairs, GRAIN / 2, [&]( size_t begin, size_t end, unsigned int )
         {
-            i->fitness = i->fitness / average;
-        }
+            for( size_t i = begin; i < end; ++i )
+            {
+                TRACE_ITEM( i );
+
+                Random::Generator random = streams.split( i );
+                const CRTP& first = family[_parents[2 * i]].item;
+                const CRTP& second = family[_parents[(2 * i) + 1]].item;
+
+                _offspring[2 * i].item.create( first, second, true, random );
+                _offspring[(2 * i) + 1].item.create( first, second, false, random );
+            }
+        } );
+    }
+    void				mutate( const Random::Generator& streams )
+    {
+        TRACE_SPAN( "mutation" );
+
+        // Only worth the time it takes to tell the time when there is something to learn from it
+        bool measuring = startEvaluating();
 
-        std::vector<CRTP*>   mates;
+        _pool->parallelFor( family.size(), GRAIN, [&]( size_t begin, size_t end, unsigned int worker )
+        {
+            Evaluation& evaluation = _evaluations[worker];
+            mutate( family, begin, end, streams, evaluation, measuring );
+
+            // Each pair of children is measured against the fitter of their parents, which are still in _offspring
+            for( size_t i = begin; measuring && i < end; ++i )
+            {
+                size_t pair = i / 2;
+                Fitness parent = std::max( _offspring[_parents[2 * pair]].fitness, _offspring[_parents[(2 * pair) + 1]].fitness );
+
+                measured( evaluation, i - begin, family[i].fitness, parent );
+            }
+        } );
+
+        finishEvaluating( measuring );
+    }
+    // Mutates items [begin, end), each from its own stream split from streams, and works out the fitness of those
+    //  the cache does not already know. While measuring, evaluation is left holding the mutation each item got,
+    //  whether it changed anything and the seconds it took, from begin on.
+    void                mutate( std::vector<Item>& items, size_t begin, size_t end, const Random::Generator& streams, Evaluation& evaluation, bool measuring )
+    {
+        // Counted per chunk so that the threads are not all hammering the same counters
+        uint64_t hits = 0;
+        evaluation.clear();
 
-remate:
-        for( unsigned int i = 0; i != family.size(); ++i )
+        for( size_t i = begin; i < end; ++i )
         {
-            for( unsigned int j = 0; j < (unsigned int)family[i].fitness; ++j )
-                mates.push_back( &family[i].item );
+            TRACE_ITEM( i );
+
+            Random::Generator random = streams.split( i );
+
+            unsigned int mutation = _scheduler.pick( random );
+
+            if( measuring )
+            {
+                uint64_t before = items[i].item.hash();
+
+                auto start = std::chrono::steady_clock::now();
+                CRTP::mutation( mutation )( &(items[i].item), random );
+                evaluation.seconds.push_back( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
 
-            unsigned int chance = (unsigned int)(10000.0 * fmod( family[i].fitness, 1 ));
-            if( Random::gen(10000) < chance )
-                mates.push_back( &family[i].item );
+                // A mutation that changed nothing gets no credit for what recombination did
+                evaluation.mutations.push_back( mutation );
+                evaluation.changed.push_back( items[i].item.hash() != before );
+            }
+            else
+                CRTP::mutation( mutation )( &(items[i].item), random );
+
+            uint64_t key = 0;
+            if( _cache )
+            {
+                key = items[i].item.hash();
+
+                if( _cache->find( key, items[i].fitness ) )
+                {
+                    hits++;
+                    continue;
+                }
+            }
+
+            evaluation.indices.push_back( i );
+            evaluation.items.push_back( &(items[i].item) );
+            evaluation.keys.push_back( key );
         }
 
-        if( mates.size() < _familySize / 2 )
-            goto remate;
+        // Everything left is evaluated together, so that items which can share work do, see GeneticItem::evaluate
+        TRACE_ITEM( begin / GRAIN );
+
+        size_t count = evaluation.items.size();
+        evaluation.fitness.resize( count );
+
+        auto start = measuring ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        CRTP::evaluate( evaluation.items.data(), count, evaluation.fitness.data() );
+        // Evaluated together, so each shares the time equally
+        double share = measuring && count != 0 ? std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() / count : 0.0;
 
-        GeneticPairs pairs;
-        for( int i = (int)mates.size() - 1; i >= 1; i -= 2 )
+        for( size_t j = 0; j < count; ++j )
         {
-            unsigned int a = Random::gen( (unsigned int)mates.size() );
-            unsigned int b = Random::gen( (unsigned int)mates.size() );
+            Fitness fitness = evaluation.fitness[j];
+            if( isinf( fitness ) )
+                fitness = 0.0;
 
-            while( a == b )
-                b = Random::gen( (unsigned int)mates.size() );
+            items[evaluation.indices[j]].fitness = fitness;
+            if( _cache )
+                _cache->insert( evaluation.keys[j], fitness );
 
-            pairs.push_back( { mates[a], mates[b] } );
+            if( measuring )
+                evaluation.seconds[evaluation.indices[j] - begin] += share;
         }
 
-        return pairs;
+        _cacheHits += hits;
+        _cacheMisses += _cache ? count : 0;
+        _evaluated += count;
     }
-    std::vector<Item>   recombination( const GeneticPairs& pairs )
+    // Clears the counts of the evaluations about to be made, and says whether the mutations are to be measured
+    bool                startEvaluating()
     {
-        std::vector<Item> newFamily;
-        for( unsigned int i = 0; i < pairs.size(); ++i )
-        {
-            newFamily.push_back( { CRTP(), 0.0 } );
-            newFamily[2 * i].item.create( *pairs[i].first, *pairs[i].second, true );
+        _cacheHits = 0;
+        _cacheMisses = 0;
+        _evaluated = 0;
+
+        _evaluations.resize( _pool->size() );
+        for( auto i = _evaluations.begin(); i != _evaluations.end(); ++i )
+            std::fill( i->outcomes, i->outcomes + CRTP::MUTATIONS, MutationScheduler::Outcome() );
+
+        return _scheduler.mode() == MutationScheduler::ADAPTIVE;
+    }
+    // Credits the mutation of the index'th item of the last chunk mutated with what it gained over its parent
+    void                measured( Evaluation& evaluation, size_t index, Fitness fitness, Fitness parent )
+    {
+        MutationScheduler::Outcome& outcome = evaluation.outcomes[evaluation.mutations[index]];
 
-            newFamily.push_back( { CRTP(), 0.0 } );
-            newFamily[(2 * i) + 1].item.create( *pairs[i].first, *pairs[i].second, false );
+        outcome.calls++;
+        if( evaluation.changed[index] )
+            outcome.gain += std::max( fitness - parent, 0.0 );
+        outcome.seconds += evaluation.seconds[index];
+    }
+    void                finishEvaluating( bool measuring )
+    {
+        _totalHits += _cacheHits;
+        _totalMisses += _cacheMisses;
+        _totalEvaluated += _evaluated;
+
+        if( measuring )
+        {
+            MutationScheduler::Outcome outcomes[MutationScheduler::MAX_MUTATIONS] = {};
+            for( auto e = _evaluations.begin(); e != _evaluations.end(); ++e )
+            {
+                for( unsigned int m = 0; m < CRTP::MUTATIONS; ++m )
+                {
+                    outcomes[m].calls += e->outcomes[m].calls;
+                    outcomes[m].gain += e->outcomes[m].gain;
+                    outcomes[m].seconds += e->outcomes[m].seconds;
+                }
+            }
+            _scheduler.update( outcomes );
         }
-        return newFamily;
     }
-    void				mutate()
+
+    // Breeds as many children as there are items, with no barrier between selection, recombination, mutation and
+    //  evaluation: each worker takes STEADY_GRAIN children at a time through all of them and puts them straight
+    //  back into the family, while the other workers carry on with theirs. Parents are the fittest of a tournament
+    //  at the time they are picked, so they may have been born moments before. Each child replaces the least fit of
+    //  a tournament, unless it is less fit still, so the fittest is never lost.
+    // The workers race each other for the family, so only a single thread repeats exactly from its seed.
+    void                steadyState( const Random::Generator& random )
     {
-        for( auto i = family.begin(); i != family.end(); ++i )
+        TRACE_SPAN( "steady state" );
+
+        Random::Generator selectionStreams = random.split( SELECTION_STREAM );
+        Random::Generator recombinationStreams = random.split( RECOMBINATION_STREAM );
+        Random::Generator mutationStreams = random.split( MUTATION_STREAM );
+        Random::Generator replacementStreams = random.split( REPLACEMENT_STREAM );
+
+        // The children are built in _offspring, each chunk in its own part of it
+        size_t pairs = family.size() / 2;
+        _offspring.resize( pairs * 2 );
+
+        if( _lockCount != family.size() )
         {
-            auto function = selectMutation();
+            _lockCount = family.size();
+            _locks.reset( new std::atomic<bool>[_lockCount] );
+            for( size_t i = 0; i < _lockCount; ++i )
+                _locks[i] = false;
+        }
+
+        bool measuring = startEvaluating();
+
+        _pool->parallelFor( pairs, STEADY_GRAIN / 2, [&]( size_t begin, size_t end, unsigned int worker )
+        {
+            Evaluation& evaluation = _evaluations[worker];
+            evaluation.parents.clear();
+
+            for( size_t i = begin; i < end; ++i )
+            {
+                TRACE_ITEM( i );
+
+                // Copied out, as another worker may replace them at any moment
+                Random::Generator selection = selectionStreams.split( i );
+                Item first = item( tournament( selection, true ) );
+                Item second = item( tournament( selection, true ) );
+
+                Random::Generator recombination = recombinationStreams.split( i );
+                _offspring[2 * i].item.create( first.item, second.item, true, recombination );
+                _offspring[(2 * i) + 1].item.create( first.item, second.item, false, recombination );
+
+                evaluation.parents.push_back( std::max( first.fitness, second.fitness ) );
+            }
+
+            mutate( _offspring, 2 * begin, 2 * end, mutationStreams, evaluation, measuring );
+
+            for( size_t i = 2 * begin; i < 2 * end; ++i )
+            {
+                if( measuring )
+                    measured( evaluation, i - 2 * begin, _offspring[i].fitness, evaluation.parents[i / 2 - begin] );
 
-            function( &(i->item) );
+                Random::Generator replacement = replacementStreams.split( i );
+                size_t loser = tournament( replacement, false );
 
-            i->fitness = i->item.fitness();
+                lock( loser );
+                if( !(_offspring[i].fitness < family[loser].fitness) )
+                    std::swap( family[loser], _offspring[i] );
+                unlock( loser );
+            }
+        } );
 
-            if( isinf( i->fitness ) )
-                i->fitness = 0.0;
+        finishEvaluating( measuring );
+    }
+    // The fittest (or least fit) of _tournamentSize items picked at random, as they are at the time
+    size_t              tournament( Random::Generator& random, bool fittest )
+    {
+        size_t best = random.gen( (unsigned int)family.size() );
+        Fitness bestFitness = fitness( best );
+
+        for( unsigned int j = 1; j < _tournamentSize; ++j )
+        {
+            size_t challenger = random.gen( (unsigned int)family.size() );
+            Fitness challengerFitness = fitness( challenger );
+
+            if( fittest ? challengerFitness > bestFitness : challengerFitness < bestFitness )
+            {
+                best = challenger;
+                bestFitness = challengerFitness;
+            }
         }
+        return best;
     }
+    // The family as it is while other workers replace its items, see steadyState()
+    Fitness             fitness( size_t index )
+    {
+        lock( index );
+        Fitness fitness = family[index].fitness;
+        unlock( index );
+        return fitness;
+    }
+    Item                item( size_t index )
+    {
+        lock( index );
+        Item item = family[index];
+        unlock( index );
+        return item;
+    }
+    void                lock( size_t index )
+    {
+        while( _locks[index].exchange( true, std::memory_order_acquire ) )
+        {
+            while( _locks[index].load( std::memory_order_relaxed ) )
+                std::this_thread::yield();
+        }
+    }
+    void                unlock( size_t index )
+    {
+        _locks[index].store( false, std::memory_order_release );
+    }
+    // The indices of the first count items of the family in the order given
+    template <typename Compare>
+    std::vector<unsigned int>   ranking( unsigned int count, Compare compare ) const
+    {
+        std::vector<unsigned int> order( family.size() );
+        std::iota( order.begin(), order.end(), 0u );
+
+        count = std::min( count, (unsigned int)order.size() );
+        std::partial_sort( order.begin(), order.begin() + count, order.end(), [&]( unsigned int a, unsigned int b ){ return compare( family[a], family[b] ); } );
+        order.resize( count );
 
+        return order;
+    }
 	// Records original family size
 	unsigned int		_familySize;
+
+    Random::Generator           _random;
+    uint64_t                    _generation;
+
+    std::unique_ptr<ThreadPool> _pool;
+
+    std::unique_ptr<Selection<Item>>    _selection;
+    Mode                                _mode;
+    unsigned int                        _tournamentSize;
+    // One for each item of the family, held while an item is read or replaced in steady state
+    std::unique_ptr<std::atomic<bool>[]>    _locks;
+    size_t                              _lockCount;
+    Parents                             _parents;
+    // The other half of the double buffer: family's children are built here, then the two are swapped
+    std::vector<Item>                   _offspring;
+
+    // The items of a chunk still to be evaluated after mutation, one set per worker so that none are allocated
+    struct Evaluation
+    {
+        std::vector<size_t>     indices;
+        std::vector<CRTP*>      items;
+        std::vector<uint64_t>   keys;
+        std::vector<Fitness>    fitness;
+        // While the mutations are being measured, which one each item of the chunk got and the seconds it took
+        std::vector<unsigned int>   mutations;
+        std::vector<bool>           changed;
+        std::vector<double>         seconds;
+        // Summed over every chunk the worker took this generation
+        MutationScheduler::Outcome  outcomes[MutationScheduler::MAX_MUTATIONS];
+        // In steady state, the fitness of the fitter parent of each pair of the chunk
+        std::vector<Fitness>        parents;
+
+        void                    clear()
+        {
+            indices.clear();
+            items.clear();
+            keys.clear();
+            mutations.clear();
+            changed.clear();
+            seconds.clear();
+        }
+    };
+    std::vector<Evaluation>             _evaluations;
+
+    std::unique_ptr<FitnessCache>   _cache;
+    std::atomic<uint64_t>           _cacheHits;
+    std::atomic<uint64_t>           _cacheMisses;
+    uint64_t                        _totalHits;
+    uint64_t                        _totalMisses;
+    std::atomic<uint64_t>           _evaluated;
+    uint64_t                        _totalEvaluated;
+
+    MutationScheduler               _scheduler;
 };
\ No newline at end of file
@@ -1,14 +1,36 @@
 #pragma once
 
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Random.h"
+
 template <typename CRTP>
-class GeneticItem abstract
+class GeneticItem
 {
 public:
-    typedef void Mutation( CRTP* );
+    // An item also has MUTATIONS of these, handed out by a static mutation( index ), and the relative chances of each
+    //  in a static mutationWeights[MUTATIONS], see Scheduler.h
+    typedef void Mutation( CRTP*, Random::Generator& );
 public:
     GeneticItem()
     {}
 
-    virtual void    create( const CRTP& a, const CRTP& b, bool side ) = 0;
+    virtual void    create( const CRTP& a, const CRTP& b, bool side, Random::Generator& random ) = 0;
     virtual double  fitness() = 0;
+    // Works out the fitness of count items at once. Items that can share work between similar items hide this with
+    //  their own version, which has to give exactly what fitness() gives for each of them.
+    static void     evaluate( CRTP* const* items, size_t count, double* fitness )
+    {
+        for( size_t i = 0; i < count; ++i )
+            fitness[i] = items[i]->fitness();
+    }
+    // Identical items must hash the same, so that their fitness can be shared
+    virtual uint64_t    hash() const = 0;
+
+    // Appends the item to message, in a form read can rebuild it from in another process
+    virtual void    write( std::vector<char>& message ) const = 0;
+    // Rebuilds the item from the front of [in, end) and moves in past it. Returns false if that is not a valid item.
+    virtual bool    read( const char*& in, const char* end ) = 0;
 };
\ No newline at end of file
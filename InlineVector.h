@@ -0,0 +1,215 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+#include <initializer_list>
+
+// A vector of trivially copyable items that keeps up to Capacity of them inside itself, and only goes to the heap
+//  once it grows past that. Sized so that the usual truss never allocates: copying one is a single memcpy.
+template <typename T, unsigned int Capacity>
+class InlineVector
+{
+    static_assert( std::is_trivially_copyable<T>::value, "InlineVector only holds items that can be memcpy'd" );
+public:
+    typedef T           value_type;
+    typedef T*          iterator;
+    typedef const T*    const_iterator;
+    typedef size_t      size_type;
+public:
+    InlineVector()
+        : _data( local() ), _size( 0 ), _capacity( Capacity )
+    {
+    }
+    explicit InlineVector( size_t count )
+        : InlineVector()
+    {
+        resize( count );
+    }
+    InlineVector( size_t count, const T& value )
+        : InlineVector()
+    {
+        resize( count, value );
+    }
+    InlineVector( std::initializer_list<T> list )
+        : InlineVector()
+    {
+        assign( list.begin(), list.end() );
+    }
+    InlineVector( const InlineVector& vec )
+        : InlineVector()
+    {
+        assign( vec.begin(), vec.end() );
+    }
+    InlineVector( InlineVector&& vec )
+        : InlineVector()
+    {
+        take( vec );
+    }
+    ~InlineVector()
+    {
+        release();
+    }
+
+    InlineVector&   operator =( const InlineVector& vec )
+    {
+        if( this != &vec )
+            assign( vec.begin(), vec.end() );
+        return *this;
+    }
+    InlineVector&   operator =( InlineVector&& vec )
+    {
+        if( this != &vec )
+        {
+            release();
+            _data = local();
+            _size = 0;
+            _capacity = Capacity;
+            take( vec );
+        }
+        return *this;
+    }
+
+    iterator        begin()             { return _data; }
+    iterator        end()               { return _data + _size; }
+    const_iterator  begin() const       { return _data; }
+    const_iterator  end() const         { return _data + _size; }
+
+    T*              data()              { return _data; }
+    const T*        data() const        { return _data; }
+
+    size_t          size() const        { return _size; }
+    size_t          capacity() const    { return _capacity; }
+    bool            empty() const       { return _size == 0; }
+
+    T&              operator []( size_t i )         { return _data[i]; }
+    const T&        operator []( size_t i ) const   { return _data[i]; }
+    T&              front()             { return _data[0]; }
+    const T&        front() const       { return _data[0]; }
+    T&              back()              { return _data[_size - 1]; }
+    const T&        back() const        { return _data[_size - 1]; }
+
+    void            clear()
+    {
+        _size = 0;
+    }
+    void            reserve( size_t count )
+    {
+        if( count > _capacity )
+            grow( count );
+    }
+    void            resize( size_t count, const T& value = T() )
+    {
+        reserve( count );
+        for( size_t i = _size; i < count; ++i )
+            _data[i] = value;
+        _size = count;
+    }
+    template <typename It>
+    void            assign( It first, It last )
+    {
+        _size = 0;
+        insert( end(), first, last );
+    }
+
+    void            push_back( const T& value )
+    {
+        if( _size == _capacity )
+        {
+            // The value may live inside us, so take a copy before moving house
+            T copy = value;
+            grow( _capacity * 2 );
+            _data[_size++] = copy;
+        }
+        else
+            _data[_size++] = value;
+    }
+    void            pop_back()
+    {
+        _size--;
+    }
+    iterator        insert( const_iterator position, const T& value )
+    {
+        size_t index = position - _data;
+        T copy = value;
+
+        reserve( _size + 1 );
+        memmove( _data + index + 1, _data + index, (_size - index) * sizeof( T ) );
+        _data[index] = copy;
+        _size++;
+
+        return _data + index;
+    }
+    template <typename It>
+    iterator        insert( const_iterator position, It first, It last )
+    {
+        size_t index = position - _data;
+        size_t count = std::distance( first, last );
+
+        reserve( _size + count );
+        memmove( _data + index + count, _data + index, (_size - index) * sizeof( T ) );
+        std::copy( first, last, _data + index );
+        _size += count;
+
+        return _data + index;
+    }
+    iterator        erase( const_iterator position )
+    {
+        return erase( position, position + 1 );
+    }
+    iterator        erase( const_iterator first, const_iterator last )
+    {
+        size_t index = first - _data;
+        size_t count = last - first;
+
+        memmove( _data + index, _data + index + count, (_size - index - count) * sizeof( T ) );
+        _size -= count;
+
+        return _data + index;
+    }
+private:
+    T*              local()
+    {
+        return reinterpret_cast<T*>( &_local );
+    }
+    void            grow( size_t count )
+    {
+        count = std::max<size_t>( count, _capacity * 2 );
+
+        T* data = static_cast<T*>( ::operator new( count * sizeof( T ) ) );
+        memcpy( data, _data, _size * sizeof( T ) );
+
+        release();
+        _data = data;
+        _capacity = (unsigned int)count;
+    }
+    void            release()
+    {
+        if( _data != local() )
+            ::operator delete( _data );
+    }
+    // Steals the heap buffer if there is one, otherwise copies the local items across. vec is left empty.
+    void            take( InlineVector& vec )
+    {
+        if( vec._data != vec.local() )
+        {
+            _data = vec._data;
+            _size = vec._size;
+            _capacity = vec._capacity;
+
+            vec._data = vec.local();
+            vec._capacity = Capacity;
+        }
+        else
+            assign( vec.begin(), vec.end() );
+
+        vec._size = 0;
+    }
+
+    T*              _data;
+    unsigned int    _size;
+    unsigned int    _capacity;
+    typename std::aligned_storage<sizeof( T ) * Capacity, alignof( T )>::type   _local;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include "Genetic.h"
+#include "Channel.h"
+
+// One population of an island model. Islands are linked in a ring: every few generations each one sends copies of
+//  its fittest items on to the next island, and takes in what the previous island sent in place of its least fit.
+// The channels decide where the islands live, whether threads of one process or separate processes.
+template <typename CRTP>
+class Island
+{
+public:
+    typedef GeneticAlgorithm<CRTP>          Algorithm;
+    typedef typename Algorithm::Item        Item;
+public:
+    // An interval or migrant count of 0 leaves the island on its own
+    Island( Algorithm& algorithm, Channel& next, Channel& previous, unsigned int interval, unsigned int migrants )
+        : _algorithm( algorithm ), _next( next ), _previous( previous ), _interval( interval ), _migrants( migrants ), _linked( true )
+    {
+    }
+
+    // Runs a generation, migrating if one is due. Migration waits for the previous island to catch up, which keeps
+    //  the islands in step (and the results repeatable) however the processes are scheduled.
+    void                process()
+    {
+        _algorithm.process();
+
+        if( _interval == 0 || _migrants == 0 || _algorithm.generation() % _interval != 0 )
+            return;
+
+        _algorithm.emigrants( _migrants, _items );
+        pack( _items, _message );
+        _next.send( _message );
+
+        // Once the previous island has finished there is nobody left to wait for
+        if( !_linked )
+            return;
+
+        if( !_previous.receive( _message ) )
+            _linked = false;
+        else if( unpack( _message, _items ) )
+            _algorithm.immigrate( _items );
+    }
+
+    // Lets the next island know that nothing more is coming
+    void                finish()
+    {
+        _next.close();
+    }
+
+    static void         pack( const std::vector<Item>& items, std::vector<char>& message )
+    {
+        uint32_t count = (uint32_t)items.size();
+
+        message.clear();
+        message.insert( message.end(), reinterpret_cast<const char*>( &count ), reinterpret_cast<const char*>( &count + 1 ) );
+
+        for( auto i = items.begin(); i != items.end(); ++i )
+        {
+            message.insert( message.end(), reinterpret_cast<const char*>( &i->fitness ), reinterpret_cast<const char*>( &i->fitness + 1 ) );
+            i->item.write( message );
+        }
+    }
+    // Returns false, leaving items empty, if the message is malformed
+    static bool         unpack( const std::vector<char>& message, std::vector<Item>& items )
+    {
+        const char* in = message.data();
+        const char* end = in + message.size();
+
+        items.clear();
+
+        uint32_t count;
+        if( message.size() < sizeof( count ) )
+            return false;
+
+        memcpy( &count, in, sizeof( count ) );
+        in += sizeof( count );
+
+        for( uint32_t i = 0; i < count; ++i )
+        {
+            Item item;
+            if( (size_t)(end - in) < sizeof( item.fitness ) )
+                break;
+
+            memcpy( &item.fitness, in, sizeof( item.fitness ) );
+            in += sizeof( item.fitness );
+
+            if( !item.item.read( in, end ) )
+                break;
+
+            items.push_back( item );
+        }
+
+        if( items.size() != count )
+        {
+            items.clear();
+            return false;
+        }
+        return true;
+    }
+private:
+    Algorithm&          _algorithm;
+    Channel&            _next;
+    Channel&            _previous;
+    unsigned int        _interval;
+    unsigned int        _migrants;
+    bool                _linked;
+
+    std::vector<Item>   _items;
+    std::vector<char>   _message;
+};
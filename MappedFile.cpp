@@ -0,0 +1,70 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+MappedFile::MappedFile( const std::string& path )
+    : _data( nullptr ), _size( 0 ), _file( INVALID_HANDLE_VALUE ), _mapping( nullptr )
+{
+    _file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if( _file == INVALID_HANDLE_VALUE )
+        return;
+
+    LARGE_INTEGER size;
+    if( !GetFileSizeEx( _file, &size ) || size.QuadPart == 0 )
+        return;
+
+    _mapping = CreateFileMappingA( _file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( _mapping == nullptr )
+        return;
+
+    _data = static_cast<const char*>( MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 ) );
+    if( _data != nullptr )
+        _size = (size_t)size.QuadPart;
+}
+MappedFile::~MappedFile()
+{
+    if( _data != nullptr )
+        UnmapViewOfFile( _data );
+    if( _mapping != nullptr )
+        CloseHandle( _mapping );
+    if( _file != INVALID_HANDLE_VALUE )
+        CloseHandle( _file );
+}
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile( const std::string& path )
+    : _data( nullptr ), _size( 0 ), _file( -1 )
+{
+    _file = open( path.c_str(), O_RDONLY );
+    if( _file < 0 )
+        return;
+
+    struct stat info;
+    if( fstat( _file, &info ) != 0 || info.st_size == 0 )
+        return;
+
+    void* data = mmap( nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, _file, 0 );
+    if( data == MAP_FAILED )
+        return;
+
+    // All of it is about to be read, so start reading it in now
+    madvise( data, (size_t)info.st_size, MADV_WILLNEED );
+
+    _data = static_cast<const char*>( data );
+    _size = (size_t)info.st_size;
+}
+MappedFile::~MappedFile()
+{
+    if( _data != nullptr )
+        munmap( const_cast<char*>( _data ), _size );
+    if( _file >= 0 )
+        close( _file );
+}
+#endif
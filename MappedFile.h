@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// A whole file mapped read-only into memory. Pages are only read in as they are touched.
+class MappedFile
+{
+public:
+    // Check valid() to see whether it worked
+    explicit MappedFile( const std::string& path );
+    ~MappedFile();
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator =( const MappedFile& ) = delete;
+
+    bool            valid() const
+    {
+        return _data != nullptr;
+    }
+    const char*     data() const
+    {
+        return _data;
+    }
+    size_t          size() const
+    {
+        return _size;
+    }
+private:
+    const char*     _data;
+    size_t          _size;
+#ifdef _WIN32
+    void*           _file;
+    void*           _mapping;
+#else
+    int             _file;
+#endif
+};
@@ -1,129 +1,248 @@
 #include "Mutations.h"
 #include "Random.h"
+#include "Trace.h"
+#include "Counters.h"
 
 #include <algorithm>
 
 const unsigned int MAX_PASSES = 12;
+// Plain draws moveNode makes before falling back to drawing along a ray
+const unsigned int MOVE_TRIES = 4;
 
-void    addNode( Truss* truss )
+namespace
 {
+    // The stretch of origin + t * direction, for t of 0 and up, that lies inside every region it has been cut down to.
+    //  The regions are all convex, so that is always one stretch, and each cut is a few operations.
+    class Ray
+    {
+    public:
+        // direction has to be of unit length
+        Ray( const Vector& origin, double dx, double dy )
+            : _origin( origin ), _direction( dx, dy ), _nearest( 0.0 ), _furthest( HUGE_VAL )
+        {
+        }
+
+        // Keeps the part of the ray no more than radius from centre
+        void    within( const Vector& centre, double radius )
+        {
+            Vector offset = _origin - centre;
+            double half = dot( offset, _direction );
+            double discriminant = half * half - (dot( offset, offset ) - radius * radius);
+
+            if( discriminant < 0.0 )
+            {
+                _furthest = -HUGE_VAL;
+                return;
+            }
+
+            double root = sqrt( discriminant );
+            _nearest = std::max( _nearest, -half - root );
+            _furthest = std::min( _furthest, -half + root );
+        }
+        // Keeps the part of the ray inside the box
+        void    between( double lowX, double highX, double lowY, double highY )
+        {
+            slab( _origin.x, _direction.x, lowX, highX );
+            slab( _origin.y, _direction.y, lowY, highY );
+        }
+
+        bool    empty() const
+        {
+            return !(_nearest <= _furthest);
+        }
+        double  nearest() const
+        {
+            return _nearest;
+        }
+        double  furthest() const
+        {
+            return _furthest;
+        }
+        Vector  at( double t ) const
+        {
+            return Vector( _origin.x + t * _direction.x, _origin.y + t * _direction.y );
+        }
+    private:
+        void    slab( double origin, double direction, double low, double high )
+        {
+            if( direction == 0.0 )
+            {
+                if( origin < low || origin > high )
+                    _furthest = -HUGE_VAL;
+                return;
+            }
+
+            double a = (low - origin) / direction;
+            double b = (high - origin) / direction;
+            _nearest = std::max( _nearest, std::min( a, b ) );
+            _furthest = std::min( _furthest, std::max( a, b ) );
+        }
+
+        Vector  _origin;
+        Vector  _direction;
+        double  _nearest;
+        double  _furthest;
+    };
+}
+
+void    addNode( Truss* truss, Random::Generator& random )
+{
+    TRACE_DETAIL( "addNode" );
+
     // Find a node with at most 4 connections
-    std::vector<NodeIterator> potentials;
-    for( auto i = truss->nodes.begin(); i != truss->nodes.end(); ++i )
+    NodeIndices potentials;
+    for( NodeIndex i = 0; i < truss->nodes.size(); ++i )
     {
-        if( i->connected.size() < 4 )
+        if( truss->connectionCount( i ) < 4 )
             potentials.push_back( i );
     }
 
     if( potentials.size() == 0 )
         return;
 
-    NodeIterator nodeA = potentials[Random::gen( (unsigned int)potentials.size() )];
-    NodeIterator nodeB = nodeA->connected[Random::gen( (unsigned int)nodeA->connected.size() )].node;
+    NodeIndices connected;
 
-    // Now make a new node and insert it
-    Node newNode;
+    NodeIndex nodeA = potentials[random.gen( (unsigned int)potentials.size() )];
+    truss->neighbours( nodeA, connected );
+    NodeIndex nodeB = connected[random.gen( (unsigned int)connected.size() )];
 
-    do
-    {
-        double angle = atan( (nodeA->x - nodeB->x) / (nodeA->y - nodeB->y) ) + Random::normalGen( 0.0, 0.1 );
-        double dist = Random::normalGen( 70.0, 60.0 );
+    const Node& a = truss->nodes[nodeA];
+    const Node& b = truss->nodes[nodeB];
 
-        // And extend it from midpoint away from the centre
-        double midX = (nodeA->x + nodeB->x) / 2.0;
-        double midY = (nodeA->y + nodeB->y) / 2.0;
+    // The new node goes out from the midpoint of a and b, roughly along them and away from the centre. Where it can go
+    //  along that line is cut down to within a member of both, and to a truss no longer than it can be, so the
+    //  distance is drawn from that stretch alone.
+    double angle = atan( (a.x - b.x) / (a.y - b.y) ) + random.normalGen( 0.0, 0.1 );
+    Vector middle( (a.x + b.x) / 2.0, (a.y + b.y) / 2.0 );
 
-        newNode.x = midX + copysign( (dist * cos( angle )), midX );
-        newNode.y = midY + copysign( (dist * sin( angle )), midY );
+    Ray ray( middle, copysign( fabs( cos( angle ) ), middle.x ), copysign( fabs( sin( angle ) ), middle.y ) );
+    ray.within( a, Truss::MAX_MEMBER_LENGTH );
+    ray.within( b, Truss::MAX_MEMBER_LENGTH );
+    ray.within( truss->nodes.front(), Truss::MAX_TRUSS_LENGTH + 5.0 );
+    ray.within( truss->nodes.back(), Truss::MAX_TRUSS_LENGTH + 5.0 );
 
-        // ALSO continue if we find that adding this node makes the truss too large
-        if( distance( newNode, *truss->nodes.begin() ) > (Truss::MAX_TRUSS_LENGTH + 5.0) || distance( newNode, *std::prev( truss->nodes.end() )) > (Truss::MAX_TRUSS_LENGTH + 5.0) )
-            continue;
+    if( ray.empty() )
+        return;
+
+    Vector position = ray.at( random.truncatedFoldedNormalGen( 70.0, 60.0, ray.nearest(), ray.furthest() ) );
+    Node newNode( position.x, position.y );
 
-    } while( distance( newNode, *nodeA ) > Truss::MAX_MEMBER_LENGTH && distance( newNode, *nodeB ) > Truss::MAX_MEMBER_LENGTH );
-    auto it = truss->nodes.insert( newNode );
+    auto it = truss->insert( newNode );
+
+    // Another node is already sitting on that x
+    if( it.second == false )
+        return;
+
+    // Everything from the new node onwards has moved along one
+    if( nodeA >= it.first )
+        nodeA++;
+    if( nodeB >= it.first )
+        nodeB++;
 
     truss->connect( it.first, nodeA, 1.0 );
     truss->connect( it.first, nodeB, 1.0 );
 
 }
-void    removeNode( Truss* truss )
+void    removeNode( Truss* truss, Random::Generator& random )
 {
+    TRACE_DETAIL( "removeNode" );
+
     // Find a suitable join. This would be one with only two joints.
-    std::vector<NodeIterator> potentials;
-    for( auto i = std::next( truss->nodes.begin() ); i != std::prev( truss->nodes.end() ); ++i )
+    NodeIndices potentials;
+    for( NodeIndex i = 1; i + 1 < truss->nodes.size(); ++i )
     {
-        if( i->connected.size() == 2 )
+        if( truss->connectionCount( i ) == 2 )
             potentials.push_back( i );
     }
 
     if( potentials.size() == 0 )
         return;
 
-    NodeIterator it = potentials[Random::gen( (unsigned int)potentials.size() )];
+    NodeIndex it = potentials[random.gen( (unsigned int)potentials.size() )];
 
-    if( it == truss->findMiddle() )
+    if( it == truss->middle() )
         return;
 
-    // Disconnect, which will erase the node as well
-    truss->disconnect( it, it->connected[1].node );
-    truss->disconnect( it, it->connected[0].node );
+    NodeIndices connected;
+    truss->neighbours( it, connected );
+
+    // Disconnect, and then erase the node
+    truss->disconnect( it, connected[1] );
+    truss->disconnect( it, connected[0] );
+    truss->eraseUnconnected();
 }
-void    moveNode( Truss* truss )
+void    moveNode( Truss* truss, Random::Generator& random )
 {
+    TRACE_DETAIL( "moveNode" );
+
     // Find a node at random
-    auto it = std::next( truss->nodes.begin(), Random::gen( (unsigned int)truss->nodes.size()-1) );
+    NodeIndex it = random.gen( (unsigned int)truss->nodes.size()-1 );
 
     // Record it
-    Node n;
-    n.connected = it->connected;
-
-    bool isCentre = (it == truss->findMiddle());
+    NodeIndices connected;
+    truss->neighbours( it, connected );
 
-    // Now move it around
-    int tries = 20;
+    bool isCentre = (it == truss->middle());
+    const Node& from = truss->nodes[it];
 
-retry:
-    tries--;
-    if( tries == 0 ) 
-        return;
-
-    n.x = it->x + Random::normalGen( 0.0, 15 );
-    n.y = it->y + Random::normalGen( 0.0, 15 );
+    // Every member short enough, and the centre still in the (open) centre box
+    auto allowed = [&]( const Vector& n )
+    {
+        for( auto i = connected.begin(); i != connected.end(); ++i )
+        {
+            if( distance( n, truss->nodes[*i] ) > Truss::MAX_MEMBER_LENGTH )
+                return false;
+        }
+        return !isCentre || (n.x > -5.0 && n.x < 5.0 && n.y < 0.0);
+    };
 
-    for( auto i = n.connected.begin(); i != n.connected.end(); ++i )
+    // Now move it around by a normal step in each of x and y, kept only if it is allowed. Up to MOVE_TRIES of those
+    //  give exactly the normal step conditioned on where the node may go, as the mutation always used.
+    for( unsigned int tries = 0; tries < MOVE_TRIES; ++tries )
     {
-        if( distance( n, *i->node ) > Truss::MAX_MEMBER_LENGTH )
-            goto retry;
+        Vector n( from.x + random.normalGen( 0.0, 15.0 ), from.y + random.normalGen( 0.0, 15.0 ) );
+        if( allowed( n ) )
+        {
+            // Which fails if another node is already at that x
+            truss->move( it, n );
+            return;
+        }
     }
 
-    if( isCentre && !(n.x > -5.0 && n.x < 5.0 && n.y < 0.0) )
-        goto retry;
+    // Where the node may go holds little of the step's spread, typically when a member is already at full length.
+    //  Rather than keep trying, go in a random direction, cut to where the node may go, by a distance drawn from the
+    //  step's radius truncated to that stretch. That is not the same as the conditioned step: every direction gets the
+    //  same chance however short its stretch, so from here the node moves towards the limit it is pressed against
+    //  more often than the normal step would.
+    double angle = 2.0 * M_PI * random.uniform();
 
-    // End of retry block
+    Ray ray( from, cos( angle ), sin( angle ) );
+    for( auto i = connected.begin(); i != connected.end(); ++i )
+        ray.within( truss->nodes[*i], Truss::MAX_MEMBER_LENGTH );
+    if( isCentre )
+        ray.between( -5.0, 5.0, -DBL_MAX, 0.0 );
 
-    // Now erase and re-insert
-    auto newIt = truss->nodes.insert( n );
-
-    if( newIt.second == false )
+    if( ray.empty() )
         return;
 
-    // And re-do the members
-    for( auto i = n.connected.begin(); i != n.connected.end(); ++i )
-    {
-        std::find( (i->node)->connected.begin(), (i->node)->connected.end(), it )->node = newIt.first;
-    }
+    Vector n = ray.at( random.truncatedRadiusGen( 15.0, ray.nearest(), ray.furthest() ) );
+
+    // The centre box is open, and the draw can land right on its edge
+    if( !allowed( n ) )
+        return;
 
-    truss->nodes.erase( it );
+    truss->move( it, n );
 }
-void    thicken( Truss* truss )
+void    thicken( Truss* truss, Random::Generator& random )
 {
+    TRACE_DETAIL( "thicken" );
+
     // We can either add more sticks to a member, or remove some
-    unsigned int mode = Random::gen( 2 );
+    unsigned int mode = random.gen( 2 );
 
     if( mode == 1 )
     {
-        auto members = truss->calculateSafeties( truss->findMiddle() );
+        auto members = truss->calculateSafeties( truss->middle() );
         auto member = std::min_element( members.begin(), members.end(), []( const Truss::Safety& a, const Truss::Safety& b ){ return a.maxForce < b.maxForce; } );
 
         if( member->tension == false && truss->thicknessSum < 20.6 )
@@ -131,88 +250,79 @@ void    thicken( Truss* truss )
             // Check that this member has 5 or less sticks going through
             int aThickness = 0.0;
             int bThickness = 0.0;
-            for( auto i = member->nodeA->connected.begin(); i != member->nodeA->connected.end(); ++i )
+            for( auto i = truss->connections.begin(); i != truss->connections.end(); ++i )
             {
-                aThickness += (int)(i->thickness);
-            }
-            for( auto i = member->nodeB->connected.begin(); i != member->nodeB->connected.end(); ++i )
-            {
-                bThickness += (int)(i->thickness);
+                if( i->touches( member->nodeA ) )
+                    aThickness += (int)(i->thickness);
+                if( i->touches( member->nodeB ) )
+                    bThickness += (int)(i->thickness);
             }
 
             if( aThickness >= Truss::MAX_THICKNESS || bThickness >= Truss::MAX_THICKNESS)
                 return;
 
-            auto aConnection = std::find( member->nodeA->connected.begin(), member->nodeA->connected.end(), member->nodeB );
-            auto bConnection = std::find( member->nodeB->connected.begin(), member->nodeB->connected.end(), member->nodeA );
+            // The safeties line up with the connections
+            unsigned int connection = (unsigned int)(member - members.begin());
+            double thickness = truss->connections[connection].thickness;
 
-            if( aConnection->thickness < 1.1 && truss->thicknessSum < 20.1 )
-            {
-                aConnection->thickness = 2.0;
-                bConnection->thickness = 2.0;
-                truss->thicknessSum += 1.0;
-            }
-            else if( aConnection->thickness < 2.1 && aConnection->thickness > 1.1 && truss->thicknessSum < 20.6 )
-            {
-                aConnection->thickness = 2.5;
-                bConnection->thickness = 2.5;
-                truss->thicknessSum += (2.5 - aConnection->thickness);
-            }
+            if( thickness < 1.1 && truss->thicknessSum < 20.1 )
+                truss->setThickness( connection, 2.0 );
+            else if( thickness < 2.1 && thickness > 1.1 && truss->thicknessSum < 20.6 )
+                truss->setThickness( connection, 2.5 );
         }
     }
     else
     {
-        auto members = truss->calculateSafeties( truss->findMiddle() );
+        auto members = truss->calculateSafeties( truss->middle() );
         Newton minMemberForce = std::min_element( members.begin(), members.end(), []( const Truss::Safety& a, const Truss::Safety& b ){ return a.maxForce < b.maxForce; } )->maxForce;
 
-        std::vector<std::pair<NodeIterator, NodeIterator>> potentials;
+        // The safeties come back in the same order as the connections, so an index identifies both
+        InlineVector<unsigned int, INLINE_CONNECTIONS> potentials;
 
-        for( auto i = truss->nodes.begin(); i != truss->nodes.end(); ++i )
+        for( unsigned int i = 0; i < truss->connections.size(); ++i )
         {
-            for( auto j = i->connected.begin(); j != i->connected.end(); ++j )
-            {
-                if( *j->node < *i || j->thickness < 1.1 )
-                    continue;
+            if( truss->connections[i].thickness < 1.1 )
+                continue;
 
-                potentials.push_back( { i, j->node } );
-            }
+            potentials.push_back( i );
         }
 
         if( potentials.size() == 0 )
             return;
 
-        auto selection = potentials[Random::gen( (unsigned int)potentials.size() )];
+        unsigned int selection = potentials[random.gen( (unsigned int)potentials.size() )];
 
-        Newton maxForce =   std::find_if( members.begin(), members.end(), 
-                                [selection]( const Truss::Safety& member )
-                                { 
-                                    return (selection.first == member.nodeA && selection.second == member.nodeB) || (selection.first == member.nodeB && selection.second == member.nodeA);
-                                } 
-                            )->maxForce;
+        Newton maxForce = members[selection].maxForce;
 
         if( maxForce > minMemberForce * 0.125 )
             return;
 
-        auto aConnection = std::find( selection.first->connected.begin(), selection.first->connected.end(), selection.second );
-        auto bConnection = std::find( selection.second->connected.begin(), selection.second->connected.end(), selection.first );
+        truss->setThickness( selection, 1.0 );
+    }
+}
 
-        truss->thicknessSum += (1.0 - aConnection->thickness);
+// Calls the mutation, counting the call under counter and the calls that change nothing under the counter after it
+template <Truss::Mutation* MUTATION, Counters::Counter COUNTER>
+static void     counted( Truss* truss, Random::Generator& random )
+{
+    unsigned int edits = truss->edits();
 
-        aConnection->thickness = 1.0;
-        bConnection->thickness = 1.0;
-    }
+    MUTATION( truss, random );
+
+    Counters::add( COUNTER );
+    if( truss->edits() == edits )
+        Counters::add( (Counters::Counter)(COUNTER + 1) );
 }
 
-Truss::Mutation*   selectMutation()
+Truss::Mutation*   Truss::mutation( unsigned int index )
 {
-    int chance = Random::gen( 5 );
-
-    if( chance == 0 )
-        return addNode;
-    else if( chance == 1 )
-        return removeNode;
-    else if( chance == 2 )
-        return thicken;
-    else
-        return moveNode;
-}
\ No newline at end of file
+    static Mutation* const mutations[MUTATIONS] =
+    {
+        counted<addNode, Counters::ADD_NODE>,
+        counted<removeNode, Counters::REMOVE_NODE>,
+        counted<thicken, Counters::THICKEN>,
+        counted<moveNode, Counters::MOVE_NODE>
+    };
+
+    return mutations[index];
+}
@@ -2,10 +2,8 @@
 
 #include "Truss.h"
 
-void    addNode( Truss* truss );
-void    removeNode( Truss* truss );
+void    addNode( Truss* truss, Random::Generator& random );
+void    removeNode( Truss* truss, Random::Generator& random );
 //void    switchMember( Truss* truss ); NOT COMPLETED
-void    moveNode( Truss* truss );
-void    thicken( Truss* truss );
-
-Truss::Mutation*   selectMutation();
\ No newline at end of file
+void    moveNode( Truss* truss, Random::Generator& random );
+void    thicken( Truss* truss, Random::Generator& random );
\ No newline at end of file
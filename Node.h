@@ -1,24 +1,22 @@
 #pragma once
 
-#include <vector>
-#include <set>
 #include "Dimensional.h"
+#include "InlineVector.h"
 
 typedef double Newton;
 
-struct Node : public Vector
-{
-    struct Connection
-    {
-        double thickness;
-        std::set<Node>::iterator node;
+// Position of a node within its truss's node list
+typedef unsigned int NodeIndex;
 
-        bool operator ==( std::set<Node>::iterator it )
-        {
-            return node == it;
-        }
-    };
+// Room kept inside each truss. Enough for all but the odd design (most have 9-11 nodes and 15-19 members),
+//  which can still grow past it by going to the heap.
+const unsigned int  INLINE_NODES = 12;
+const unsigned int  INLINE_CONNECTIONS = 24;
 
+typedef InlineVector<NodeIndex, INLINE_NODES>   NodeIndices;
+
+struct Node : public Vector
+{
     Node()
     {
     }
@@ -27,8 +25,6 @@ struct Node : public Vector
     {
     }
 
-    mutable std::vector<Connection>  connected;
-
     bool operator >( const Node& node ) const
     {
         return x > node.x;
@@ -38,5 +34,27 @@ struct Node : public Vector
         return x < node.x;
     }
 };
-typedef std::set<Node>      NodeSet;
-typedef NodeSet::iterator   NodeIterator;
+typedef InlineVector<Node, INLINE_NODES>   NodeList;
+
+// A member joining two nodes. a is always the smaller index of the two.
+struct Connection
+{
+    NodeIndex   a;
+    NodeIndex   b;
+    double      thickness;
+
+    bool        touches( NodeIndex node ) const
+    {
+        return a == node || b == node;
+    }
+    NodeIndex   other( NodeIndex node ) const
+    {
+        return a == node ? b : a;
+    }
+
+    bool operator <( const Connection& con ) const
+    {
+        return a < con.a || (a == con.a && b < con.b);
+    }
+};
+typedef InlineVector<Connection, INLINE_CONNECTIONS> Connections;
@@ -0,0 +1,265 @@
+#include "PackedTruss.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdexcept>
+
+unsigned int        (&PackedTruss::mutationWeights)[PackedTruss::MUTATIONS] = Truss::mutationWeights;
+
+namespace
+{
+    // Two counts, then the bounding box as the left, bottom and the size of a step each way
+    struct Header
+    {
+        uint8_t     nodes;
+        uint8_t     members;
+        float       left;
+        float       bottom;
+        float       stepX;
+        float       stepY;
+    };
+    const size_t    HEADER_BYTES = 2 + 4 * sizeof( float );
+    const size_t    NODE_BYTES = 2 * sizeof( uint16_t );
+    const size_t    MEMBER_BYTES = 3;
+    const double    STEPS = 65535.0;
+
+    // The trusses each thread unpacks into, kept so that their lists are only ever allocated once
+    struct Workspace
+    {
+        Truss                   left;
+        Truss                   right;
+        Truss                   child;
+        std::vector<Truss>      batch;
+        std::vector<Truss*>     pointers;
+    };
+    Workspace&  workspace()
+    {
+        static thread_local Workspace instance;
+        return instance;
+    }
+
+    // Where the box starts, and a step big enough that STEPS of them reach its far side
+    void        box( double low, double high, float& start, float& step )
+    {
+        start = (float)low;
+        if( start > low )
+            start = nextafterf( start, -INFINITY );
+
+        step = (float)((high - start) / STEPS);
+        if( start + STEPS * step < high )
+            step = nextafterf( step, INFINITY );
+    }
+    // perStep is 1 / step, or 0 for a box with nothing across it
+    unsigned int    quantise( double value, float start, double perStep )
+    {
+        double steps = (value - start) * perStep + 0.5;
+        return steps <= 0.0 ? 0 : (unsigned int)std::min( steps, STEPS );
+    }
+
+    void        put16( uint8_t* out, uint16_t value )
+    {
+        out[0] = (uint8_t)value;
+        out[1] = (uint8_t)(value >> 8);
+    }
+    uint16_t    get16( const uint8_t* in )
+    {
+        return (uint16_t)(in[0] | (in[1] << 8));
+    }
+
+    template <unsigned int INDEX>
+    void        mutated( PackedTruss* packed, Random::Generator& random )
+    {
+        Truss& truss = workspace().child;
+        packed->unpack( truss );
+
+        unsigned int edits = truss.edits();
+        Truss::mutation( INDEX )( &truss, random );
+
+        if( truss.edits() != edits )
+            packed->pack( truss );
+    }
+}
+
+void                PackedTruss::pack( const Truss& truss )
+{
+    size_t nodes = truss.nodes.size();
+    size_t members = truss.connections.size();
+    if( nodes > 255 || members > 255 )
+        throw std::runtime_error( "Error: A truss with more than 255 nodes or members can not be packed" );
+
+    Header header = { (uint8_t)nodes, (uint8_t)members, 0.0f, 0.0f, 0.0f, 0.0f };
+    if( nodes != 0 )
+    {
+        double bottom = truss.nodes[0].y;
+        double top = bottom;
+        for( auto i = truss.nodes.begin(); i != truss.nodes.end(); ++i )
+        {
+            bottom = std::min( bottom, i->y );
+            top = std::max( top, i->y );
+        }
+        box( truss.nodes.front().x, truss.nodes.back().x, header.left, header.stepX );
+        box( bottom, top, header.bottom, header.stepY );
+    }
+
+    _bytes.resize( HEADER_BYTES + nodes * NODE_BYTES + members * MEMBER_BYTES );
+    uint8_t* out = _bytes.data();
+
+    out[0] = header.nodes;
+    out[1] = header.members;
+    memcpy( out + 2, &header.left, 4 * sizeof( float ) );
+    out += HEADER_BYTES;
+
+    // Rounding must not leave two nodes on the same x, so a node that lands on the last one moves a step on. There are
+    //  far more steps than nodes, so any that run off the end are pushed back down from there.
+    double perStepX = header.stepX == 0.0f ? 0.0 : 1.0 / header.stepX;
+    double perStepY = header.stepY == 0.0f ? 0.0 : 1.0 / header.stepY;
+
+    uint16_t xs[255];
+    for( size_t i = 0; i < nodes; ++i )
+    {
+        unsigned int x = quantise( truss.nodes[i].x, header.left, perStepX );
+        if( i > 0 && x <= xs[i - 1] )
+            x = xs[i - 1] + 1u;
+        xs[i] = (uint16_t)std::min( x, (unsigned int)STEPS );
+    }
+    for( size_t i = nodes; i-- > 1; )
+    {
+        if( xs[i - 1] >= xs[i] )
+            xs[i - 1] = xs[i] - 1;
+    }
+
+    for( size_t i = 0; i < nodes; ++i, out += NODE_BYTES )
+    {
+        put16( out, xs[i] );
+        put16( out + 2, (uint16_t)quantise( truss.nodes[i].y, header.bottom, perStepY ) );
+    }
+
+    for( auto i = truss.connections.begin(); i != truss.connections.end(); ++i, out += MEMBER_BYTES )
+    {
+        out[0] = (uint8_t)i->a;
+        out[1] = (uint8_t)i->b;
+        out[2] = (uint8_t)std::min( std::max( floor( i->thickness * 2.0 + 0.5 ), 0.0 ), 255.0 );
+    }
+}
+void                PackedTruss::unpack( Truss& truss ) const
+{
+    const uint8_t* in = _bytes.data();
+
+    // A PackedTruss that was never packed holds no bytes at all, and unpacks to an empty truss like a new Truss
+    Header header = { 0, 0, 0.0f, 0.0f, 0.0f, 0.0f };
+    if( !_bytes.empty() )
+    {
+        header.nodes = in[0];
+        header.members = in[1];
+        memcpy( &header.left, in + 2, 4 * sizeof( float ) );
+        in += HEADER_BYTES;
+    }
+
+    truss.nodes.resize( header.nodes );
+    for( unsigned int i = 0; i < header.nodes; ++i, in += NODE_BYTES )
+    {
+        truss.nodes[i].x = header.left + get16( in ) * (double)header.stepX;
+        truss.nodes[i].y = header.bottom + get16( in + 2 ) * (double)header.stepY;
+
+        // Steps far smaller than the box is from 0 can round onto the same x
+        if( i > 0 && !(truss.nodes[i].x > truss.nodes[i - 1].x) )
+            truss.nodes[i].x = nextafter( truss.nodes[i - 1].x, INFINITY );
+    }
+
+    truss.connections.resize( header.members );
+    truss.memberCount = header.members;
+    truss.thicknessSum = 0.0;
+    for( unsigned int i = 0; i < header.members; ++i, in += MEMBER_BYTES )
+    {
+        Connection& connection = truss.connections[i];
+        connection.a = in[0];
+        connection.b = in[1];
+        connection.thickness = in[2] / 2.0;
+
+        truss.thicknessSum += connection.thickness;
+    }
+
+    truss._laidOut = false;
+    truss.changed( Truss::TOPOLOGY );
+}
+Truss               PackedTruss::unpack() const
+{
+    Truss truss;
+    unpack( truss );
+    return truss;
+}
+
+void                PackedTruss::create( const PackedTruss& a, const PackedTruss& b, bool side, Random::Generator& random )
+{
+    Workspace& w = workspace();
+    a.unpack( w.left );
+    b.unpack( w.right );
+
+    w.child.create( w.left, w.right, side, random );
+    pack( w.child );
+}
+double              PackedTruss::fitness()
+{
+    Truss& truss = workspace().child;
+    unpack( truss );
+    return truss.fitness();
+}
+void                PackedTruss::evaluate( PackedTruss* const* trusses, size_t count, double* fitness )
+{
+    Workspace& w = workspace();
+    if( w.batch.size() < count )
+        w.batch.resize( count );
+
+    w.pointers.resize( count );
+    for( size_t i = 0; i < count; ++i )
+    {
+        trusses[i]->unpack( w.batch[i] );
+        w.pointers[i] = &w.batch[i];
+    }
+
+    Truss::evaluate( w.pointers.data(), count, fitness );
+}
+uint64_t            PackedTruss::hash() const
+{
+    // FNV-1a over the bytes, finished off as Truss::hash is so that the low bits the cache indexes with are well mixed
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for( auto i = _bytes.begin(); i != _bytes.end(); ++i )
+        hash = (hash ^ *i) * 0x100000001B3ull;
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+void                PackedTruss::write( std::vector<char>& message ) const
+{
+    Truss& truss = workspace().child;
+    unpack( truss );
+    truss.write( message );
+}
+bool                PackedTruss::read( const char*& in, const char* end )
+{
+    Truss& truss = workspace().child;
+    if( !truss.read( in, end ) )
+        return false;
+
+    pack( truss );
+    return true;
+}
+
+PackedTruss::Mutation*  PackedTruss::mutation( unsigned int index )
+{
+    static_assert( MUTATIONS == 4, "Every mutation needs an entry here" );
+    static Mutation* const mutations[MUTATIONS] =
+    {
+        mutated<0>,
+        mutated<1>,
+        mutated<2>,
+        mutated<3>
+    };
+
+    return mutations[index];
+}
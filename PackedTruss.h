@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "GeneticItem.h"
+#include "InlineVector.h"
+#include "Truss.h"
+
+// A truss kept in as few bytes as it takes, for populations too large to hold as Trusses. Each node is a pair of 16 bit
+//  steps across the truss's bounding box, and each member its two nodes and its thickness in half sticks. A typical
+//  ten node design packs into about 110 bytes, which are held inline, so an individual stays under 200 bytes.
+// Breeding, mutating and evaluating unpack into a Truss the thread keeps for the purpose, and pack what comes out
+//  again. Packing rounds each node to the nearest step (well under a hundredth of a millimetre across a full span),
+//  so a truss comes back very nearly but not exactly as it went in, and it is the rounded truss that gets evaluated.
+class PackedTruss : public GeneticItem<PackedTruss>
+{
+public:
+    // The same mutations as a Truss, with the same chances
+    static const unsigned int   MUTATIONS = Truss::MUTATIONS;
+    static unsigned int         (&mutationWeights)[MUTATIONS];
+public:
+    PackedTruss()
+    {
+    }
+    explicit PackedTruss( const Truss& truss )
+    {
+        pack( truss );
+    }
+
+    // Throws if the truss has more than 255 nodes or members
+    void            pack( const Truss& truss );
+    // Reuses the truss's lists, so that unpacking into the same truss again does not allocate
+    void            unpack( Truss& truss ) const;
+    Truss           unpack() const;
+
+    void            create( const PackedTruss& a, const PackedTruss& b, bool side, Random::Generator& random );
+    double          fitness();
+    // Unpacks the lot and hands them on to Truss::evaluate, so that those sharing a topology are still solved together
+    static void     evaluate( PackedTruss* const* trusses, size_t count, double* fitness );
+    uint64_t        hash() const;
+    // The same message as the unpacked truss writes, so a snapshot can be read back into either
+    void            write( std::vector<char>& message ) const;
+    bool            read( const char*& in, const char* end );
+
+    static Mutation*    mutation( unsigned int index );
+
+    size_t          bytes() const
+    {
+        return _bytes.size();
+    }
+private:
+    // Enough for 14 nodes and 25 members before going to the heap
+    static const unsigned int   INLINE_BYTES = 160;
+
+    InlineVector<uint8_t, INLINE_BYTES> _bytes;
+};
+
+// The working form of a population's items, whichever they are kept as
+inline const Truss& unpacked( const Truss& truss )
+{
+    return truss;
+}
+inline Truss        unpacked( const PackedTruss& truss )
+{
+    return truss.unpack();
+}
@@ -1,24 +1,155 @@
 #include "Random.h"
 
-#include <random>
+#include <math.h>
+#include <algorithm>
 
 using namespace Random;
 
-std::default_random_engine  randomEngine;
+namespace
+{
+    uint64_t    splitMix( uint64_t& x )
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    double      normalCdf( double z )
+    {
+        return 0.5 * erfc( -z * M_SQRT1_2 );
+    }
+    // The chance of a standard normal falling in [low -> high], from whichever tail keeps its precision
+    double      normalMass( double low, double high )
+    {
+        if( low > 0.0 )
+            return normalCdf( -low ) - normalCdf( -high );
+        return normalCdf( high ) - normalCdf( low );
+    }
+    // Acklam's rational approximation, refined by a step of Halley's method to close to double precision
+    double      inverseNormalCdf( double p )
+    {
+        static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+        static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01 };
+        static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+        static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00 };
+        const double        split = 0.02425;
+
+        if( p <= 0.0 )
+            return -HUGE_VAL;
+        if( p >= 1.0 )
+            return HUGE_VAL;
+
+        double x;
+        if( p < split || p > 1.0 - split )
+        {
+            double q = sqrt( -2.0 * log( p < split ? p : 1.0 - p ) );
+            x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+            if( p > split )
+                x = -x;
+        }
+        else
+        {
+            double q = p - 0.5;
+            double r = q * q;
+            x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+        }
+
+        // Past here the correction's exp overflows, and the approximation is already as close as a double gets
+        if( fabs( x ) > 37.0 )
+            return x;
+
+        double e = normalCdf( x ) - p;
+        double u = e * sqrt( 2.0 * M_PI ) * exp( x * x / 2.0 );
+        return x - u / (1.0 + x * u / 2.0);
+    }
+}
 
-void            Random::seed( unsigned int s )
+Generator::Generator( uint64_t seed )
+    : _key( seed ), _spare( 0.0 ), _hasSpare( false )
 {
-    randomEngine.seed( s );
+    // Expand the seed so that nearby seeds do not give nearby states (and the state is never all zero)
+    uint64_t x = seed;
+    for( int i = 0; i < 4; ++i )
+        _state[i] = splitMix( x );
 }
-unsigned int    Random::gen( unsigned int max )
+Generator       Generator::split( uint64_t stream ) const
 {
-    std::uniform_int_distribution<int> dist( 0, max - 1 );
+    uint64_t x = _key ^ (stream * 0xD1B54A32D192ED03ull);
+    splitMix( x );
 
-    return dist( randomEngine );
+    return Generator( splitMix( x ) );
 }
-double          Random::normalGen( double mean, double sd )
+double          Generator::normalGen( double mean, double sd )
 {
-    std::normal_distribution<double> dist( mean, sd );
+    if( _hasSpare )
+    {
+        _hasSpare = false;
+        return mean + sd * _spare;
+    }
+
+    double u, v, s;
+    do
+    {
+        u = 2.0 * uniform() - 1.0;
+        v = 2.0 * uniform() - 1.0;
+        s = u * u + v * v;
+    } while( s >= 1.0 || s == 0.0 );
+
+    s = sqrt( -2.0 * log( s ) / s );
 
-    return dist( randomEngine );
-}
\ No newline at end of file
+    _spare = v * s;
+    _hasSpare = true;
+
+    return mean + sd * u * s;
+}
+double          Generator::truncatedNormalGen( double mean, double sd, double low, double high )
+{
+    // Keeping a first draw that lands in range and inverting otherwise still gives exactly the truncated normal
+    double first = normalGen( mean, sd );
+    if( first >= low && first <= high )
+        return first;
+
+    double lowZ = (low - mean) / sd;
+    double highZ = (high - mean) / sd;
+
+    // Far out on the upper side the distribution rounds to 1, so draw from the mirror image there instead
+    double z;
+    if( lowZ > 0.0 )
+    {
+        double from = normalCdf( -highZ );
+        z = -inverseNormalCdf( from + uniform() * (normalCdf( -lowZ ) - from) );
+    }
+    else
+    {
+        double from = normalCdf( lowZ );
+        z = inverseNormalCdf( from + uniform() * (normalCdf( highZ ) - from) );
+    }
+
+    // Rounding, or a range with next to nothing in it, can land just outside
+    return std::min( std::max( mean + sd * z, low ), high );
+}
+double          Generator::truncatedFoldedNormalGen( double mean, double sd, double low, double high )
+{
+    double first = fabs( normalGen( mean, sd ) );
+    if( first >= low && first <= high )
+        return first;
+
+    // The size lands in [low -> high] when the normal does, or when it lands in [-high -> -low]
+    double positive = normalMass( (low - mean) / sd, (high - mean) / sd );
+    double negative = normalMass( (-high - mean) / sd, (-low - mean) / sd );
+
+    if( uniform() * (positive + negative) < positive )
+        return truncatedNormalGen( mean, sd, low, high );
+    return -truncatedNormalGen( mean, sd, -high, -low );
+}
+double          Generator::truncatedRadiusGen( double sd, double low, double high )
+{
+    // The chance of being further out than r is exp( -r^2 / 2 sd^2 ), which inverts exactly
+    double scale = -0.5 / (sd * sd);
+    double from = exp( scale * low * low );
+    double to = exp( scale * high * high );
+
+    double r = sqrt( log( from - uniform() * (from - to) ) / scale );
+    return std::min( std::max( r, low ), high );
+}
@@ -1,10 +1,71 @@
 #pragma once
 
+#include <stdint.h>
+
 namespace Random
 {
-    void            seed( unsigned int s );
+    // A xoshiro256** generator. Generators are cheap to copy and carry no shared state, so every thread or
+    //  individual can own one. Independent generators are made by splitting a parent by a stream number,
+    //  which only depends on the parent's seed and the stream, never on how many numbers the parent has drawn.
+    class Generator
+    {
+    public:
+        Generator( uint64_t seed = 0 );
+
+        // Returns a new, independent generator for the given stream of this one
+        Generator       split( uint64_t stream ) const;
+
+        uint64_t        next()
+        {
+            uint64_t result = rotate( _state[1] * 5, 7 ) * 9;
+            uint64_t t = _state[1] << 17;
+
+            _state[2] ^= _state[0];
+            _state[3] ^= _state[1];
+            _state[1] ^= _state[2];
+            _state[0] ^= _state[3];
+            _state[2] ^= t;
+            _state[3] = rotate( _state[3], 45 );
+
+            return result;
+        }
+
+        // Generates a number from (and including) 0 up to (but not including) max, or [0 -> max)
+        unsigned int    gen( unsigned int max )
+        {
+            return (unsigned int)(((next() >> 32) * max) >> 32);
+        }
+        // Generates a number in [0 -> 1)
+        double          uniform()
+        {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+        double          normalGen( double mean, double sd );
+        // A normal drawn only from [low -> high]. One plain draw is tried first, and if that misses the distribution
+        //  is inverted over the range, so the cost is bounded however little of it the range holds. low must not be
+        //  above high.
+        double          truncatedNormalGen( double mean, double sd, double low, double high );
+        // The size of a normal, drawn only from [low -> high] in the same way. low must be at least 0 and not above high.
+        double          truncatedFoldedNormalGen( double mean, double sd, double low, double high );
+        // How far a point is from its mean when both of its coordinates are normal with the same sd, drawn only from
+        //  [low -> high] by inverting its distribution, which is cheap. low must be at least 0 and not above high.
+        double          truncatedRadiusGen( double sd, double low, double high );
+
+        uint64_t        key() const
+        {
+            return _key;
+        }
+    private:
+        static uint64_t rotate( uint64_t x, int k )
+        {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        uint64_t        _state[4];
+        uint64_t        _key;
 
-    // Generates a number from (and including) 0 up to (but not including) max, or [0 -> max)
-    unsigned int    gen( unsigned int max );
-    double          normalGen( double mean, double sd );
-}
\ No newline at end of file
+        // The polar method makes normals in pairs, the second is kept for the next call
+        double          _spare;
+        bool            _hasSpare;
+    };
+}
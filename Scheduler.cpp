@@ -0,0 +1,96 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+
+const unsigned int MutationScheduler::MAX_MUTATIONS;
+const double    MutationScheduler::LEARNING_RATE = 0.3;
+const double    MutationScheduler::PURSUIT_RATE = 0.3;
+const double    MutationScheduler::MINIMUM_PROBABILITY = 0.05;
+
+MutationScheduler::MutationScheduler()
+    : _mode( FIXED ), _weights( nullptr ), _count( 0 )
+{
+}
+
+void            MutationScheduler::reset( Mode mode, const unsigned int* weights, unsigned int count )
+{
+    _mode = mode;
+    _weights = weights;
+    _count = std::min( count, MAX_MUTATIONS );
+
+    unsigned int total = 0;
+    for( unsigned int i = 0; i < _count; ++i )
+        total += _weights[i];
+
+    // The table as it stands, with every mutation given at least the minimum
+    double spare = 1.0 - _count * MINIMUM_PROBABILITY;
+    for( unsigned int i = 0; i < _count; ++i )
+    {
+        double share = total == 0 ? (i == _count - 1 ? 1.0 : 0.0) : (double)_weights[i] / total;
+
+        _quality[i] = 0.0;
+        _probabilities[i] = MINIMUM_PROBABILITY + spare * share;
+    }
+
+    weigh();
+}
+
+unsigned int    MutationScheduler::pick( Random::Generator& random ) const
+{
+    const unsigned int* weights = _mode == FIXED ? _weights : _adapted;
+
+    unsigned int total = 0;
+    for( unsigned int i = 0; i < _count; ++i )
+        total += weights[i];
+
+    if( total == 0 )
+        return _count - 1;
+
+    unsigned int chance = random.gen( total );
+    for( unsigned int i = 0; i < _count - 1; ++i )
+    {
+        if( chance < weights[i] )
+            return i;
+        chance -= weights[i];
+    }
+    return _count - 1;
+}
+
+void            MutationScheduler::update( const Outcome* outcomes )
+{
+    if( _mode == FIXED )
+        return;
+
+    // A mutation that went unused keeps the quality it had
+    for( unsigned int i = 0; i < _count; ++i )
+    {
+        if( outcomes[i].calls != 0 && outcomes[i].seconds > 0.0 )
+            _quality[i] += LEARNING_RATE * (outcomes[i].gain / outcomes[i].seconds - _quality[i]);
+    }
+
+    unsigned int best = (unsigned int)(std::max_element( _quality, _quality + _count ) - _quality);
+    double maximum = 1.0 - (_count - 1) * MINIMUM_PROBABILITY;
+
+    for( unsigned int i = 0; i < _count; ++i )
+        _probabilities[i] += PURSUIT_RATE * ((i == best ? maximum : MINIMUM_PROBABILITY) - _probabilities[i]);
+
+    weigh();
+}
+
+double          MutationScheduler::probability( unsigned int mutation ) const
+{
+    if( _mode == ADAPTIVE )
+        return _probabilities[mutation];
+
+    unsigned int total = 0;
+    for( unsigned int i = 0; i < _count; ++i )
+        total += _weights[i];
+
+    return total == 0 ? (mutation == _count - 1 ? 1.0 : 0.0) : (double)_weights[mutation] / total;
+}
+
+void            MutationScheduler::weigh()
+{
+    for( unsigned int i = 0; i < _count; ++i )
+        _adapted[i] = (unsigned int)(_probabilities[i] * (1 << 20) + 0.5);
+}
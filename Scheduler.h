@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Random.h"
+
+// Picks which mutation each item gets.
+//
+// FIXED draws from the item's own table of weights, so that a seed always gives the same run. ADAPTIVE learns the
+//  odds as it goes by adaptive pursuit: after each generation every mutation's quality moves towards the fitness it
+//  gained per second spent on it (measured, so runs no longer repeat exactly), and the odds move towards giving each
+//  of the rest MINIMUM_PROBABILITY and the best one whatever is left, so that none is ever given up on.
+class MutationScheduler
+{
+public:
+    enum Mode
+    {
+        FIXED,
+        ADAPTIVE
+    };
+
+    static const unsigned int   MAX_MUTATIONS = 8;
+
+    // What one generation's calls to a mutation came to
+    struct Outcome
+    {
+        uint64_t        calls;
+        double          gain;       // Fitness over the fitter parent, for the children the mutation changed that beat it
+        double          seconds;    // Spent mutating and evaluating
+    };
+
+    MutationScheduler();
+
+    // Starts over with the given mode, taking the odds from weights until there is anything to adapt them with
+    void                reset( Mode mode, const unsigned int* weights, unsigned int count );
+
+    Mode                mode() const
+    {
+        return _mode;
+    }
+    // Chooses a mutation with the current odds. In FIXED mode they are read from the weights on every call, so a
+    //  change to them takes effect straight away.
+    unsigned int        pick( Random::Generator& random ) const;
+
+    // Feeds one generation back in, an outcome per mutation. Does nothing in FIXED mode.
+    void                update( const Outcome* outcomes );
+
+    double              probability( unsigned int mutation ) const;
+private:
+    static const double LEARNING_RATE;
+    static const double PURSUIT_RATE;
+    static const double MINIMUM_PROBABILITY;
+
+    // The adapted odds as whole numbers, so that drawing from them is the same as drawing from a table of weights
+    void                weigh();
+
+    Mode                _mode;
+    const unsigned int* _weights;
+    unsigned int        _count;
+
+    double              _quality[MAX_MUTATIONS];
+    double              _probabilities[MAX_MUTATIONS];
+    unsigned int        _adapted[MAX_MUTATIONS];
+};
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <float.h>
+#include <math.h>
+
+#include "Random.h"
+#include "ThreadPool.h"
+
+enum SelectionMethod
+{
+    UNIVERSAL_SAMPLING,     // Stochastic universal sampling: every item gets its expected share of copies, give or take one
+    ALIAS_SAMPLING,         // Roulette wheel, each spin costing O(1) through an alias table
+    TOURNAMENT              // The fittest of a few picked at random
+};
+
+// Chooses the parents of the next generation from a family of items that each have a fitness, which is only read.
+// Items with no fitness at all are never chosen. Parents come back as indices into the family in random order, and each two in a row make a pair.
+// Every strategy takes O(n) (or O(nk) for tournaments of k) and spreads the work over the pool. The work is split
+//  in the same place whatever the number of threads, so the parents chosen only depend on the generator.
+template <typename Item>
+class Selection
+{
+public:
+    // Items handed out at a time when spreading work over the pool
+    static const unsigned int   GRAIN = 4096;
+public:
+    virtual ~Selection()
+    {
+    }
+
+    virtual void        select( const std::vector<Item>& family, size_t count, const Random::Generator& random, ThreadPool& pool, std::vector<unsigned int>& parents ) = 0;
+
+    static Selection*   create( SelectionMethod method, unsigned int tournamentSize );
+protected:
+    // Fills sums with the total fitness of the family before each GRAIN sized chunk, and a last entry with the total
+    static void         accumulate( const std::vector<Item>& family, ThreadPool& pool, std::vector<double>& sums )
+    {
+        sums.assign( (family.size() + GRAIN - 1) / GRAIN + 1, 0.0 );
+
+        pool.parallelFor( family.size(), GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            double sum = 0.0;
+            for( size_t i = begin; i < end; ++i )
+                sum += family[i].fitness;
+
+            sums[begin / GRAIN + 1] = sum;
+        } );
+
+        for( size_t i = 1; i < sums.size(); ++i )
+            sums[i] += sums[i - 1];
+
+        if( sums.back() < DBL_EPSILON )
+            throw std::runtime_error( "A fatal and impossible genetic defect has occured in the entire population." );
+    }
+};
+
+template <typename Item>
+class UniversalSampling : public Selection<Item>
+{
+    using Selection<Item>::GRAIN;
+public:
+    void                select( const std::vector<Item>& family, size_t count, const Random::Generator& random, ThreadPool& pool, std::vector<unsigned int>& parents )
+    {
+        parents.clear();
+        if( count == 0 )
+            return;
+
+        this->accumulate( family, pool, _sums );
+
+        // Lay count evenly spaced pointers along the total fitness, starting at a random offset.
+        // Each item is chosen once for every pointer that lands on its share.
+        Random::Generator local = random;
+        double spacing = _sums.back() / count;
+        double offset = local.uniform() * spacing;
+
+        auto pointersBefore = [&]( double position ) -> size_t
+        {
+            if( position <= offset )
+                return 0;
+            return std::min( count, (size_t)ceil( (position - offset) / spacing ) );
+        };
+
+        parents.resize( count );
+
+        pool.parallelFor( family.size(), GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            size_t chunk = begin / GRAIN;
+            double position = _sums[chunk];
+
+            // Work out which pointers belong to the chunk from the sums alone, so that rounding can never let two
+            //  chunks claim the same one
+            size_t pointer = pointersBefore( position );
+            size_t last = pointersBefore( _sums[chunk + 1] );
+
+            size_t fit = begin;
+            for( size_t i = begin; i < end; ++i )
+            {
+                if( family[i].fitness <= 0.0 )
+                    continue;
+
+                position += family[i].fitness;
+                fit = i;
+
+                while( pointer < last && offset + pointer * spacing < position )
+                    parents[pointer++] = (unsigned int)i;
+            }
+
+            // Anything left over is down to rounding, and goes to the last item that had a share
+            while( pointer < last )
+                parents[pointer++] = (unsigned int)fit;
+        } );
+
+        // Rounding can also leave the last pointer just beyond the total
+        size_t fit = family.size() - 1;
+        while( fit > 0 && family[fit].fitness <= 0.0 )
+            fit--;
+        for( size_t pointer = pointersBefore( _sums.back() ); pointer < count; ++pointer )
+            parents[pointer] = (unsigned int)fit;
+
+        // The parents come out in the order of the family, so shuffle them before they are paired up.
+        // This one pass is left on a single thread.
+        for( size_t i = count - 1; i > 0; --i )
+            std::swap( parents[i], parents[local.gen( (unsigned int)(i + 1) )] );
+    }
+private:
+    std::vector<double>         _sums;
+};
+
+template <typename Item>
+class AliasSampling : public Selection<Item>
+{
+    using Selection<Item>::GRAIN;
+public:
+    void                select( const std::vector<Item>& family, size_t count, const Random::Generator& random, ThreadPool& pool, std::vector<unsigned int>& parents )
+    {
+        this->accumulate( family, pool, _sums );
+
+        size_t size = family.size();
+        double scale = size / _sums.back();
+
+        _probability.resize( size );
+        _alias.resize( size );
+
+        pool.parallelFor( size, GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            for( size_t i = begin; i < end; ++i )
+                _probability[i] = family[i].fitness * scale;
+        } );
+
+        // Vose's method: pair off each item with less than an average share with one with more, which tops it up
+        // Items with no fitness that are left over go to the fittest. Rounding can leave every item just short of an
+        //  average share (a family of equals, say), so it is not necessarily in _large.
+        unsigned int fallback = 0;
+        _small.clear();
+        _large.clear();
+        for( unsigned int i = 0; i < size; ++i )
+        {
+            (_probability[i] < 1.0 ? _small : _large).push_back( i );
+            if( _probability[i] > _probability[fallback] )
+                fallback = i;
+        }
+
+        while( !_small.empty() && !_large.empty() )
+        {
+            unsigned int small = _small.back();
+            unsigned int large = _large.back();
+            _small.pop_back();
+
+            _alias[small] = large;
+            _probability[large] -= 1.0 - _probability[small];
+
+            if( _probability[large] < 1.0 )
+            {
+                _large.pop_back();
+                _small.push_back( large );
+            }
+        }
+
+        // Whatever is left is only away from 1 through rounding, apart from items with no fitness, which must
+        //  still never be chosen
+        for( auto i = _small.begin(); i != _small.end(); ++i )
+        {
+            if( family[*i].fitness > 0.0 )
+                _probability[*i] = 1.0;
+            else
+            {
+                _probability[*i] = 0.0;
+                _alias[*i] = fallback;
+            }
+        }
+        for( auto i = _large.begin(); i != _large.end(); ++i )
+            _probability[*i] = 1.0;
+
+        parents.resize( count );
+
+        pool.parallelFor( count, GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            Random::Generator local = random.split( begin );
+
+            for( size_t i = begin; i < end; ++i )
+            {
+                unsigned int column = local.gen( (unsigned int)size );
+                parents[i] = local.uniform() < _probability[column] ? column : _alias[column];
+            }
+        } );
+    }
+private:
+    std::vector<double>         _sums;
+    std::vector<double>         _probability;
+    std::vector<unsigned int>   _alias;
+    std::vector<unsigned int>   _small;
+    std::vector<unsigned int>   _large;
+};
+
+template <typename Item>
+class TournamentSelection : public Selection<Item>
+{
+    using Selection<Item>::GRAIN;
+public:
+    TournamentSelection( unsigned int size )
+        : _size( std::max( size, 1u ) )
+    {
+    }
+
+    void                select( const std::vector<Item>& family, size_t count, const Random::Generator& random, ThreadPool& pool, std::vector<unsigned int>& parents )
+    {
+        // Only items with some fitness get to enter. Count them per chunk, then gather them up in order.
+        _counts.assign( (family.size() + GRAIN - 1) / GRAIN + 1, 0 );
+
+        pool.parallelFor( family.size(), GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            size_t entrants = 0;
+            for( size_t i = begin; i < end; ++i )
+                entrants += family[i].fitness > 0.0;
+
+            _counts[begin / GRAIN + 1] = entrants;
+        } );
+
+        for( size_t i = 1; i < _counts.size(); ++i )
+            _counts[i] += _counts[i - 1];
+
+        if( _counts.back() == 0 )
+            throw std::runtime_error( "A fatal and impossible genetic defect has occured in the entire population." );
+
+        _entrants.resize( _counts.back() );
+
+        pool.parallelFor( family.size(), GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            size_t entrant = _counts[begin / GRAIN];
+            for( size_t i = begin; i < end; ++i )
+            {
+                if( family[i].fitness > 0.0 )
+                    _entrants[entrant++] = (unsigned int)i;
+            }
+        } );
+
+        unsigned int size = (unsigned int)_entrants.size();
+
+        parents.resize( count );
+
+        pool.parallelFor( count, GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            Random::Generator local = random.split( begin );
+
+            for( size_t i = begin; i < end; ++i )
+            {
+                unsigned int best = _entrants[local.gen( size )];
+                for( unsigned int j = 1; j < _size; ++j )
+                {
+                    unsigned int challenger = _entrants[local.gen( size )];
+                    if( family[challenger].fitness > family[best].fitness )
+                        best = challenger;
+                }
+
+                parents[i] = best;
+            }
+        } );
+    }
+private:
+    unsigned int                _size;
+    std::vector<size_t>         _counts;
+    std::vector<unsigned int>   _entrants;
+};
+
+template <typename Item>
+Selection<Item>*    Selection<Item>::create( SelectionMethod method, unsigned int tournamentSize )
+{
+    switch( method )
+    {
+    case ALIAS_SAMPLING:
+        return new AliasSampling<Item>();
+    case TOURNAMENT:
+        return new TournamentSelection<Item>( tournamentSize );
+    default:
+        return new UniversalSampling<Item>();
+    }
+}
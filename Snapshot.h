@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Genetic.h"
+#include "MappedFile.h"
+
+// Saves a whole population to disk, to be loaded back later to carry on from where it left off.
+//
+// A snapshot is a header (which includes the seed and generation, the only random state there is), the offset of
+//  every item's record, then the records: each the item's fitness followed by whatever CRTP::write puts down.
+//  Everything is in this machine's byte order.
+// Saving copies the population into memory using every thread the algorithm has, then a thread of the snapshot's
+//  own writes it out while the algorithm carries on. The last snapshot is only replaced once the new one is complete.
+// Loading maps the file and rebuilds the items across the algorithm's threads straight from the mapping.
+template <typename CRTP>
+class Snapshot
+{
+public:
+    typedef GeneticAlgorithm<CRTP>      Algorithm;
+    typedef typename Algorithm::Item    Item;
+
+    // Items copied out or read back at a time
+    static const unsigned int   GRAIN = 4096;
+public:
+    explicit Snapshot( const std::string& path )
+        : _path( path ), _writing( false )
+    {
+    }
+    ~Snapshot()
+    {
+        wait();
+    }
+
+    Snapshot( const Snapshot& ) = delete;
+    Snapshot& operator =( const Snapshot& ) = delete;
+
+    // Returns false, leaving it for another time, if the last snapshot is still being written
+    bool                save( Algorithm& algorithm )
+    {
+        if( _writing )
+            return false;
+
+        wait();
+
+        const std::vector<Item>& family = algorithm.family;
+        size_t count = family.size();
+
+        memcpy( _header.magic, MAGIC, sizeof( _header.magic ) );
+        _header.version = VERSION;
+        _header.count = count;
+        _header.generation = algorithm.generation();
+        _header.seed = algorithm.seedValue();
+
+        // Each chunk of items goes into a buffer of its own, with offsets from the start of that buffer for now
+        _chunks.resize( (count + GRAIN - 1) / GRAIN );
+        _offsets.resize( count + 1 );
+
+        algorithm.pool().parallelFor( count, GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            std::vector<char>& chunk = _chunks[begin / GRAIN];
+            chunk.clear();
+
+            for( size_t i = begin; i < end; ++i )
+            {
+                _offsets[i] = chunk.size();
+                chunk.insert( chunk.end(), reinterpret_cast<const char*>( &family[i].fitness ), reinterpret_cast<const char*>( &family[i].fitness + 1 ) );
+                family[i].item.write( chunk );
+            }
+        } );
+
+        uint64_t base = 0;
+        for( size_t c = 0; c < _chunks.size(); ++c )
+        {
+            size_t last = std::min<size_t>( count, (c + 1) * GRAIN );
+            for( size_t i = c * GRAIN; i < last; ++i )
+                _offsets[i] += base;
+
+            base += _chunks[c].size();
+        }
+        _offsets[count] = base;
+
+        _writing = true;
+        _writer = std::thread( &Snapshot::write, this );
+
+        return true;
+    }
+    // Blocks until the snapshot being written (if any) is on disk
+    void                wait()
+    {
+        if( _writer.joinable() )
+            _writer.join();
+    }
+
+    // Reads only the seed and generation the snapshot at path was saved with, without loading the family.
+    // Returns false if there is no snapshot there.
+    static bool         peek( const std::string& path, uint64_t& seed, uint64_t& generation )
+    {
+        MappedFile file( path );
+        Header header;
+        if( !readHeader( file, header ) )
+            return false;
+
+        seed = header.seed;
+        generation = header.generation;
+        return true;
+    }
+    // Replaces the algorithm's family, seed and generation with those in the snapshot at path.
+    // Returns false, leaving the algorithm alone, if there is no snapshot there or it can not be used.
+    static bool         load( Algorithm& algorithm, const std::string& path )
+    {
+        MappedFile file( path );
+        Header header;
+        if( !readHeader( file, header ) )
+            return false;
+
+        size_t table = sizeof( Header ) + (header.count + 1) * sizeof( uint64_t );
+        if( header.count > file.size() || file.size() < table )
+            return false;
+
+        // The mapping starts on a page, and the header is a whole number of offsets long, so they can be read in place
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>( file.data() + sizeof( Header ) );
+        const char* records = file.data() + table;
+        uint64_t size = file.size() - table;
+
+        if( offsets[header.count] != size )
+            return false;
+
+        std::vector<Item> family( (size_t)header.count );
+        std::atomic<bool> valid( true );
+
+        algorithm.pool().parallelFor( family.size(), GRAIN, [&]( size_t begin, size_t end, unsigned int )
+        {
+            for( size_t i = begin; i < end; ++i )
+            {
+                if( offsets[i] > offsets[i + 1] || offsets[i + 1] > size || offsets[i + 1] - offsets[i] < sizeof( double ) )
+                {
+                    valid = false;
+                    return;
+                }
+
+                const char* in = records + offsets[i];
+                const char* next = records + offsets[i + 1];
+
+                memcpy( &family[i].fitness, in, sizeof( double ) );
+                in += sizeof( double );
+
+                if( !family[i].item.read( in, next ) || in != next )
+                {
+                    valid = false;
+                    return;
+                }
+            }
+        } );
+
+        if( !valid )
+            return false;
+
+        std::swap( algorithm.family, family );
+        algorithm.resume( header.seed, header.generation );
+
+        return true;
+    }
+private:
+    static constexpr const char*    MAGIC = "GASNAPSH";
+    static const uint64_t           VERSION = 1;
+
+    struct Header
+    {
+        char        magic[8];
+        uint64_t    version;
+        uint64_t    count;
+        uint64_t    generation;
+        uint64_t    seed;
+    };
+
+    static bool         readHeader( const MappedFile& file, Header& header )
+    {
+        if( !file.valid() || file.size() < sizeof( Header ) )
+            return false;
+
+        memcpy( &header, file.data(), sizeof( header ) );
+
+        return memcmp( header.magic, MAGIC, sizeof( header.magic ) ) == 0 && header.version == VERSION && header.count != 0;
+    }
+    void                write()
+    {
+        std::string temporary = _path + ".part";
+        FILE* file = fopen( temporary.c_str(), "wb" );
+
+        bool written = file != nullptr &&
+            fwrite( &_header, sizeof( _header ), 1, file ) == 1 &&
+            fwrite( _offsets.data(), sizeof( uint64_t ), _offsets.size(), file ) == _offsets.size();
+
+        for( auto i = _chunks.begin(); written && i != _chunks.end(); ++i )
+            written = i->empty() || fwrite( i->data(), 1, i->size(), file ) == i->size();
+
+        if( file != nullptr )
+            written = fclose( file ) == 0 && written;
+
+        if( written )
+        {
+#ifdef _WIN32
+            // Windows will not rename over a file that is already there
+            remove( _path.c_str() );
+#endif
+            rename( temporary.c_str(), _path.c_str() );
+        }
+        else
+            remove( temporary.c_str() );
+
+        _writing = false;
+    }
+
+    std::string                     _path;
+    std::atomic<bool>               _writing;
+    std::thread                     _writer;
+
+    Header                          _header;
+    std::vector<uint64_t>           _offsets;
+    std::vector<std::vector<char>>  _chunks;
+};
@@ -0,0 +1,239 @@
+#include "SolvePlan.h"
+
+#include <vector>
+#include <mutex>
+#include <memory>
+
+bool            SolvePlan::build( unsigned int nodes, const Connections& connections, NodeIndex middle )
+{
+    unsigned int members = (unsigned int)connections.size();
+    if( nodes < 2 || nodes > MAX_NODES || members > MAX_MEMBERS || middle >= nodes )
+        return false;
+
+    nodeCount = (uint8_t)nodes;
+    memberCount = (uint8_t)members;
+    this->middle = (uint8_t)middle;
+    stepCount = 0;
+
+    for( unsigned int c = 0; c < members; ++c )
+    {
+        memberA[c] = (uint8_t)connections[c].a;
+        memberB[c] = (uint8_t)connections[c].b;
+    }
+
+    // Runs through Truss::calculateMembers joint by joint and pass by pass, in the same order
+    bool known[MAX_MEMBERS] = {};
+    bool resolved[MAX_NODES] = {};
+    unsigned int completed = 0;
+    unsigned int termCount = 0;
+
+    passes = 0;
+    for( ; passes < MAXIMUM_CALCULATION_PASSES && completed != nodes; ++passes )
+    {
+        for( unsigned int j = 0; j < nodes; ++j )
+        {
+            if( resolved[j] )
+                continue;
+
+            Step& step = steps[stepCount];
+            step.node = (uint8_t)j;
+            step.load = (uint8_t)(j == middle ? MIDDLE_LOAD : (j == 0 ? LEFT_LOAD : (j == nodes - 1 ? RIGHT_LOAD : NO_LOAD)));
+            step.firstKnown = (uint8_t)termCount;
+            step.knownCount = 0;
+            step.unknownCount = 0;
+
+            bool resolvable = true;
+            for( unsigned int c = 0; c < members && memberA[c] <= j; ++c )
+            {
+                if( memberA[c] != j && memberB[c] != j )
+                    continue;
+
+                Term term = { (uint8_t)c, memberA[c] == j ? memberB[c] : memberA[c] };
+
+                if( known[c] )
+                    terms[termCount + step.knownCount++] = term;
+                else if( step.unknownCount == 2 )
+                {
+                    resolvable = false;
+                    break;
+                }
+                else
+                    step.unknowns[step.unknownCount++] = term;
+            }
+
+            if( !resolvable || (step.load == NO_LOAD && step.knownCount == 0) )
+                continue;
+
+            for( unsigned int u = 0; u < step.unknownCount; ++u )
+                known[step.unknowns[u].member] = true;
+
+            termCount += step.knownCount;
+            resolved[j] = true;
+            completed++;
+            stepCount++;
+        }
+    }
+
+    complete = completed == nodes;
+    return true;
+}
+bool            SolvePlan::matches( unsigned int nodes, const Connections& connections, NodeIndex middle ) const
+{
+    if( nodes != nodeCount || middle != this->middle || connections.size() != memberCount )
+        return false;
+
+    for( unsigned int c = 0; c < memberCount; ++c )
+    {
+        if( connections[c].a != memberA[c] || connections[c].b != memberB[c] )
+            return false;
+    }
+    return true;
+}
+uint64_t        SolvePlan::fingerprint( unsigned int nodes, const Connections& connections, NodeIndex middle )
+{
+    uint64_t key = ((uint64_t)nodes << 32) ^ middle;
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        key ^= ((uint64_t)i->a << 32) | i->b;
+        key *= 0x9E3779B97F4A7C15ull;
+        key ^= key >> 29;
+    }
+    return key;
+}
+
+namespace
+{
+    const unsigned int  WAYS = 4;
+    const unsigned int  SHARDS = 64;
+
+    struct Entry
+    {
+        uint64_t        fingerprint;
+        uint64_t        used;       // When the plan was last found in its set, 0 if the entry is empty
+        SolvePlan       plan;
+    };
+
+    struct Set
+    {
+        Entry           entries[WAYS];
+        uint64_t        clock;
+    };
+
+    struct Shard
+    {
+        std::mutex      lock;
+        uint64_t        hits;
+        uint64_t        misses;
+        size_t          plans;
+    };
+
+    struct Table
+    {
+        Table()
+            : shards( new Shard[SHARDS] )
+        {
+            resize( 4 << 20 );
+        }
+
+        void            resize( size_t bytes )
+        {
+            size_t count = 0;
+            if( bytes >= sizeof( Set ) )
+            {
+                // The largest power of two that fits
+                count = 1;
+                while( count * 2 * sizeof( Set ) <= bytes )
+                    count *= 2;
+            }
+
+            sets.assign( count, Set() );
+            mask = count - 1;
+
+            for( unsigned int i = 0; i < SHARDS; ++i )
+            {
+                shards[i].hits = 0;
+                shards[i].misses = 0;
+                shards[i].plans = 0;
+            }
+        }
+
+        std::vector<Set>            sets;
+        size_t                      mask;
+        std::unique_ptr<Shard[]>    shards;
+    };
+
+    // Made on first use, as trusses can be solved while other statics are still being set up
+    Table&      table()
+    {
+        static Table instance;
+        return instance;
+    }
+}
+
+bool            SolvePlans::find( uint64_t fingerprint, unsigned int nodes, const Connections& connections, NodeIndex middle, SolvePlan& plan )
+{
+    Table& t = table();
+    if( t.sets.empty() )
+        return plan.build( nodes, connections, middle );
+
+    size_t index = (size_t)(fingerprint ^ (fingerprint >> 32)) & t.mask;
+    Set& set = t.sets[index];
+    Shard& shard = t.shards[index % SHARDS];
+
+    {
+        std::lock_guard<std::mutex> lock( shard.lock );
+        for( unsigned int w = 0; w < WAYS; ++w )
+        {
+            Entry& entry = set.entries[w];
+            if( entry.used != 0 && entry.fingerprint == fingerprint && entry.plan.matches( nodes, connections, middle ) )
+            {
+                entry.used = ++set.clock;
+                shard.hits++;
+                plan = entry.plan;
+                return true;
+            }
+        }
+        shard.misses++;
+    }
+
+    // Planned outside the lock. Two threads may plan the same topology at once, which only costs the time.
+    if( !plan.build( nodes, connections, middle ) )
+        return false;
+
+    std::lock_guard<std::mutex> lock( shard.lock );
+    Entry* oldest = &set.entries[0];
+    for( unsigned int w = 0; w < WAYS; ++w )
+    {
+        Entry& entry = set.entries[w];
+        if( entry.used != 0 && entry.fingerprint == fingerprint && entry.plan.matches( nodes, connections, middle ) )
+            return true;
+        if( entry.used < oldest->used )
+            oldest = &entry;
+    }
+
+    if( oldest->used == 0 )
+        shard.plans++;
+
+    oldest->fingerprint = fingerprint;
+    oldest->used = ++set.clock;
+    oldest->plan = plan;
+    return true;
+}
+void            SolvePlans::setCapacity( size_t bytes )
+{
+    table().resize( bytes );
+}
+SolvePlans::Statistics  SolvePlans::statistics()
+{
+    Table& t = table();
+    Statistics statistics = { 0, 0, 0, t.sets.size() * sizeof( Set ) };
+
+    for( unsigned int i = 0; i < SHARDS; ++i )
+    {
+        std::lock_guard<std::mutex> lock( t.shards[i].lock );
+        statistics.hits += t.shards[i].hits;
+        statistics.misses += t.shards[i].misses;
+        statistics.plans += t.shards[i].plans;
+    }
+    return statistics;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Node.h"
+
+// Passes the method of joints makes over the joints before it gives up
+const unsigned int  MAXIMUM_CALCULATION_PASSES = 21;
+
+// The order the method of joints resolves the joints of one topology in, worked out without any of the arithmetic.
+//
+// Whether a joint can be resolved only depends on which of its members are known, apart from one thing: a joint with
+//  nothing acting on it is passed over. A joint with no load and no known members certainly has nothing acting on
+//  it; anything else is taken to have something, which whoever carries the plan out has to check. If it turns out
+//  otherwise the truss has strayed from the plan, and has to be solved by trial after all.
+// A plan that can not get through every joint means the method of joints can not either, whatever the geometry.
+struct SolvePlan
+{
+    // Larger trusses are rare enough to always solve by trial
+    static const unsigned int   MAX_NODES = 2 * INLINE_NODES;
+    static const unsigned int   MAX_MEMBERS = 2 * INLINE_CONNECTIONS;
+
+    // The load on a joint before any member is counted
+    enum Load
+    {
+        NO_LOAD,
+        MIDDLE_LOAD,
+        LEFT_LOAD,      // The supports at either end
+        RIGHT_LOAD,
+        LOADS
+    };
+
+    // A member as seen from one of its joints
+    struct Term
+    {
+        uint8_t         member;
+        uint8_t         other;      // The node at the far end
+    };
+
+    // One joint resolved: every member already known is added to the load on the joint, in the order of the members,
+    //  then the remaining one or two are found from that
+    struct Step
+    {
+        uint8_t         node;
+        uint8_t         load;
+        uint8_t         firstKnown;     // Into terms
+        uint8_t         knownCount;
+        uint8_t         unknownCount;
+        Term            unknowns[2];
+    };
+
+    // Returns false, leaving the plan unusable, if the truss is too large to plan
+    bool                build( unsigned int nodes, const Connections& connections, NodeIndex middle );
+    bool                matches( unsigned int nodes, const Connections& connections, NodeIndex middle ) const;
+
+    // Equal for the same topology and loaded middle, whatever the geometry and thicknesses
+    static uint64_t     fingerprint( unsigned int nodes, const Connections& connections, NodeIndex middle );
+
+    uint8_t             nodeCount;
+    uint8_t             memberCount;
+    uint8_t             middle;
+    uint8_t             stepCount;
+    uint8_t             passes;         // Over the joints, as many as the method of joints would make
+    bool                complete;
+    Step                steps[MAX_NODES];
+    // Each member is known at one end at most
+    Term                terms[MAX_MEMBERS];
+    uint8_t             memberA[MAX_MEMBERS];
+    uint8_t             memberB[MAX_MEMBERS];
+};
+
+// Plans shared by every thread, keyed by their fingerprint, so that each topology is only planned once.
+// The table is set associative and never takes more memory than it is given: once a set is full, the plan used
+//  longest ago in it makes way. The sets are split into shards with a lock each to keep threads apart.
+class SolvePlans
+{
+public:
+    struct Statistics
+    {
+        uint64_t        hits;
+        uint64_t        misses;
+        size_t          plans;      // Held right now
+        size_t          bytes;      // Taken by the table, full or not
+
+        double          hitRate() const
+        {
+            return hits + misses == 0 ? 0.0 : (double)hits / (hits + misses);
+        }
+    };
+
+    // Fills in the plan for a topology, planning it (and keeping the plan) if it is not already known.
+    // Returns false if the truss is too large to plan.
+    static bool         find( uint64_t fingerprint, unsigned int nodes, const Connections& connections, NodeIndex middle, SolvePlan& plan );
+    static bool         find( unsigned int nodes, const Connections& connections, NodeIndex middle, SolvePlan& plan )
+    {
+        return find( SolvePlan::fingerprint( nodes, connections, middle ), nodes, connections, middle, plan );
+    }
+
+    // Empties the table and limits it to the given number of bytes, 4 MB to begin with. Too few bytes for a single
+    //  set turns the table off, so that every truss is planned afresh. Only call it while nothing is being solved.
+    static void         setCapacity( size_t bytes );
+    // Lookups since the capacity was last set
+    static Statistics   statistics();
+};
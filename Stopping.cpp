@@ -0,0 +1,65 @@
+#include "Stopping.h"
+
+namespace
+{
+    const char* const   NAMES[StoppingPolicy::REASONS] =
+    {
+        "running",
+        "time",
+        "generations",
+        "evaluations",
+        "stagnation",
+        "target",
+    };
+}
+
+StoppingPolicy::Limits  StoppingPolicy::timeOnly( double seconds )
+{
+    Limits limits = { seconds, 0, 0, 0, 0.0, 0.0 };
+    return limits;
+}
+
+StoppingPolicy::StoppingPolicy( const Limits& limits )
+    : _limits( limits ), _reason( RUNNING ), _started( false ), _best( 0.0 ), _mean( 0.0 ), _stagnant( 0 )
+{
+}
+
+bool            StoppingPolicy::stop( double seconds, uint64_t generations, uint64_t evaluations, double best, double mean )
+{
+    // Each is measured from where it last improved, so that slow but steady progress still adds up to an improvement,
+    //  and the mean wandering down and back up again does not
+    bool improved = !_started;
+    if( !_started || best > _best + _limits.epsilon )
+    {
+        _best = best;
+        improved = true;
+    }
+    if( !_started || mean > _mean + _limits.epsilon )
+    {
+        _mean = mean;
+        improved = true;
+    }
+    _started = true;
+
+    _stagnant = improved ? 0 : _stagnant + 1;
+
+    if( _limits.target != 0.0 && best >= _limits.target )
+        _reason = TARGET;
+    else if( _limits.stagnation != 0 && _stagnant >= _limits.stagnation )
+        _reason = STAGNATION;
+    else if( _limits.evaluations != 0 && evaluations >= _limits.evaluations )
+        _reason = EVALUATIONS;
+    else if( _limits.generations != 0 && generations >= _limits.generations )
+        _reason = GENERATIONS;
+    else if( _limits.seconds != 0.0 && seconds >= _limits.seconds )
+        _reason = TIME;
+    else
+        _reason = RUNNING;
+
+    return _reason != RUNNING;
+}
+
+const char*     StoppingPolicy::name( Reason reason )
+{
+    return NAMES[reason];
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Decides when a run has gone on long enough. It stops when any budget runs out, when the fittest reaches the target,
+//  or when neither the fittest nor the mean fitness has improved by more than epsilon for a number of generations in
+//  a row. A budget, target or stagnation limit of 0 is never checked.
+class StoppingPolicy
+{
+public:
+    enum Reason
+    {
+        RUNNING,
+        TIME,
+        GENERATIONS,
+        EVALUATIONS,
+        STAGNATION,
+        TARGET,
+        REASONS
+    };
+
+    struct Limits
+    {
+        double          seconds;
+        uint64_t        generations;
+        uint64_t        evaluations;    // Fitness evaluations, not counting those the fitness cache answered
+        unsigned int    stagnation;     // Generations in a row without an improvement
+        double          epsilon;        // What an improvement has to be more than
+        double          target;
+    };
+
+    // Nothing but the given time
+    static Limits       timeOnly( double seconds );
+
+    StoppingPolicy( const Limits& limits );
+
+    // Called after every generation with the run so far, counting from its start. Returns true once the run should
+    //  stop, and reason() then says why. Where more than one thing has run out at once, the first of TARGET,
+    //  STAGNATION, EVALUATIONS, GENERATIONS and TIME is given.
+    bool                stop( double seconds, uint64_t generations, uint64_t evaluations, double best, double mean );
+
+    Reason              reason() const
+    {
+        return _reason;
+    }
+    // Lower case, as the batch CSV has them
+    static const char*  name( Reason reason );
+private:
+    Limits              _limits;
+    Reason              _reason;
+
+    // The fittest and the mean as they were when each last improved, and the generations since either did
+    bool                _started;
+    double              _best;
+    double              _mean;
+    unsigned int        _stagnant;
+};
@@ -0,0 +1,464 @@
+// Checks of the pieces whose failures only turn up now and then, or only with particular populations. Build the
+//  truss_tests target from CMakeLists.txt and run it through ctest, or on its own to see what each check found.
+//
+// Usage: truss_tests [--filter text]
+// Runs every check whose name contains the filter text. Returns 0 if every check passed.
+
+#include "ThreadPool.h"
+#include "Selection.h"
+#include "Random.h"
+#include "Truss.h"
+#include "PackedTruss.h"
+#include "Examples.h"
+#include "TrussBatch.h"
+#include "SolvePlan.h"
+#include "Dimensional.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <math.h>
+
+namespace
+{
+    struct Check
+    {
+        const char*                 name;
+        std::function<bool()>       run;
+    };
+
+    // Says what went wrong if the condition does not hold, and passes the condition on
+    bool        expect( bool condition, const char* what )
+    {
+        if( !condition )
+            fprintf( stderr, "    failed: %s\n", what );
+        return condition;
+    }
+
+    // Thousands of back to back calls with tiny grains, so that workers are still looking for the last call's chunks
+    //  while the next call hands its own out. Every item has to be run exactly once, and every call has to return.
+    bool        threadPoolBackToBack()
+    {
+        ThreadPool pool( std::max( std::thread::hardware_concurrency(), 8u ) );
+
+        const size_t COUNT = 64;
+        std::vector<std::atomic<unsigned int>> runs( COUNT );
+        bool passed = true;
+
+        for( unsigned int call = 0; call < 200000 && passed; ++call )
+        {
+            for( size_t i = 0; i < COUNT; ++i )
+                runs[i] = 0;
+
+            size_t count = 1 + call % COUNT;
+            pool.parallelFor( count, 1 + call % 3, [&]( size_t begin, size_t end, unsigned int )
+            {
+                for( size_t i = begin; i < end; ++i )
+                    runs[i]++;
+                // Gives the other workers the chance to get in between, even with only the one processor
+                std::this_thread::yield();
+            } );
+
+            for( size_t i = 0; i < COUNT; ++i )
+                passed &= expect( runs[i] == (i < count ? 1u : 0u), "every item run exactly once" );
+        }
+
+        return passed;
+    }
+
+    // Just the fitness, which is all selection looks at
+    struct Scored
+    {
+        double      fitness;
+    };
+
+    // A family of equals, as every run starts with and converges back to, leaves rounding to put every item just
+    //  short of an average share. Every parent still has to be one of the family, and none of those with no fitness.
+    bool        aliasSamplingUniform()
+    {
+        struct Family
+        {
+            size_t      size;
+            double      fitness;
+            size_t      unfit;      // Items with no fitness at the end of the family
+        };
+        const Family families[] = { { 3, 0.1, 0 }, { 4097, 0.1, 0 }, { 500000, 0.1, 0 }, { 1000, 3.333, 0 }, { 500000, 3.333, 0 }, { 4097, 0.1, 5 } };
+
+        ThreadPool pool( 4 );
+        std::unique_ptr<Selection<Scored>> selection( Selection<Scored>::create( ALIAS_SAMPLING, 2 ) );
+        bool passed = true;
+
+        for( auto f = std::begin( families ); f != std::end( families ); ++f )
+        {
+            std::vector<Scored> family( f->size, Scored{ f->fitness } );
+            for( size_t i = 0; i < f->unfit; ++i )
+                family[f->size - 1 - i].fitness = 0.0;
+
+            std::vector<unsigned int> parents;
+            selection->select( family, family.size(), Random::Generator( 7 ), pool, parents );
+
+            bool chosen = parents.size() == family.size();
+            for( auto p = parents.begin(); p != parents.end() && chosen; ++p )
+                chosen = *p < family.size() && family[*p].fitness > 0.0;
+
+            passed &= expect( chosen, ("every parent a fit member of a family of " + std::to_string( f->size )).c_str() );
+        }
+
+        return passed;
+    }
+
+    // Every way a message can be short or corrupt has to be turned away, leaving the truss read into as it was, and
+    //  without believing counts that ask for more than the message holds
+    bool        trussReadRejects()
+    {
+        Truss source = Examples::prebuilt();
+        std::vector<char> message;
+        source.write( message );
+
+        bool passed = true;
+
+        Truss whole;
+        const char* in = message.data();
+        passed &= expect( whole.read( in, message.data() + message.size() ) && in == message.data() + message.size(), "a whole message read" );
+        passed &= expect( whole.hash() == source.hash(), "a whole message read back as it was written" );
+
+        // Every truncation of the message
+        for( size_t size = 0; size < message.size(); ++size )
+        {
+            Truss target = Examples::exa();
+            uint64_t before = target.hash();
+            int members = target.memberCount;
+            double sticks = target.thicknessSum;
+
+            in = message.data();
+            bool read = target.read( in, message.data() + size );
+
+            passed &= expect( !read && in == message.data(), "a short message turned away" );
+            passed &= expect( target.hash() == before && target.memberCount == members && target.thicknessSum == sticks, "a truss left alone by a failed read" );
+            if( !passed )
+                break;
+        }
+
+        // Counts far beyond what follows them
+        uint32_t counts[2] = { 0xFFFFFFFFu, 0xFFFFFFFFu };
+        std::vector<char> huge( message );
+        memcpy( huge.data(), counts, sizeof( counts ) );
+
+        Truss target = Examples::exa();
+        uint64_t before = target.hash();
+        in = huge.data();
+        passed &= expect( !target.read( in, huge.data() + huge.size() ) && target.hash() == before, "counts larger than the message turned away" );
+
+        // Nodes out of order
+        std::vector<char> reversed( message );
+        Node first, second;
+        memcpy( &first, reversed.data() + sizeof( counts ), sizeof( Node ) );
+        memcpy( &second, reversed.data() + sizeof( counts ) + sizeof( Node ), sizeof( Node ) );
+        memcpy( reversed.data() + sizeof( counts ), &second, sizeof( Node ) );
+        memcpy( reversed.data() + sizeof( counts ) + sizeof( Node ), &first, sizeof( Node ) );
+
+        in = reversed.data();
+        passed &= expect( !target.read( in, reversed.data() + reversed.size() ) && target.hash() == before, "nodes out of order turned away" );
+
+        return passed;
+    }
+
+    // A truss with what the solvers leave behind in view
+    struct Inspected : public Truss
+    {
+        Inspected( const Truss& truss )
+            : Truss( truss )
+        {
+        }
+
+        using Truss::loadedMiddle;
+        using Truss::solve;
+        using Truss::_forces;
+        using Truss::_weakest;
+        using Truss::_weakestMember;
+
+        // Whether following the plan for this truss runs into a joint where everything cancels out, which sends
+        //  both the scalar and the batched solve off to find the forces by trial instead. The same sums as
+        //  Truss::calculateMembers( plan ), with the forces it found.
+        bool        strays( NodeIndex middle )
+        {
+            SolvePlan plan;
+            if( !SolvePlans::find( (unsigned int)nodes.size(), connections, middle, plan ) || !plan.complete )
+                return false;
+
+            Members members = calculateMembers( plan, 1.0 );
+            Force loads[SolvePlan::LOADS];
+            jointLoads( plan.middle, 1.0, loads );
+
+            for( unsigned int s = 0; s < plan.stepCount; ++s )
+            {
+                const SolvePlan::Step& step = plan.steps[s];
+                Force resultant = loads[step.load];
+
+                for( unsigned int k = step.firstKnown; k < step.firstKnown + step.knownCount; ++k )
+                    resultant += Force( members[plan.terms[k].member].force, nodes[plan.terms[k].other] - nodes[step.node] );
+
+                if( resultant.mag == 0 )
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    // Every lane of the batched solve has to match Truss::solve to the last bit, at every width this build and this
+    //  processor have: the examples, mutated variants of them, and some of those that stray from their plan. Each
+    //  truss comes with copies of the same topology (thickened, and nudged in y) so that they are batched together.
+    bool        trussBatchMatchesScalar()
+    {
+        const Truss examples[] = { Examples::exa(), Examples::exb(), Examples::prebuilt() };
+        Random::Generator random( 11 );
+
+        std::vector<Inspected> trusses;
+        std::vector<NodeIndex> middles;
+        unsigned int strayed = 0;
+
+        auto add = [&]( const Truss& truss )
+        {
+            Inspected inspected( truss );
+            NodeIndex middle = inspected.loadedMiddle();
+            if( middle == Truss::NO_NODE )
+                return;
+
+            trusses.push_back( inspected );
+            middles.push_back( middle );
+            strayed += inspected.strays( middle ) ? 1 : 0;
+        };
+        auto family = [&]( const Truss& truss )
+        {
+            add( truss );
+
+            Truss thickened( truss );
+            thickened.setThickness( 0, thickened.connections[0].thickness + 1.0 );
+            add( thickened );
+
+            Truss nudged( truss );
+            NodeIndex node = (NodeIndex)(nudged.nodes.size() / 2);
+            nudged.move( node, Vector( nudged.nodes[node].x, nudged.nodes[node].y + 0.5 ) );
+            add( nudged );
+        };
+
+        unsigned int strays = 0;
+        for( unsigned int e = 0; e < 3; ++e )
+        {
+            family( examples[e] );
+
+            for( unsigned int v = 0; v < 20000; ++v )
+            {
+                Random::Generator stream = random.split( e * 20000 + v );
+                Truss variant( examples[e] );
+                for( unsigned int m = 0; m < 3; ++m )
+                    Truss::mutation( stream.gen( (unsigned int)Truss::MUTATIONS ) )( &variant, stream );
+
+                // Every stray, but only a sample of the rest, which are much alike
+                Inspected inspected( variant );
+                NodeIndex middle = inspected.loadedMiddle();
+                bool stray = middle != Truss::NO_NODE && inspected.strays( middle );
+                if( stray )
+                    strays++;
+                if( stray || v % 50 == 0 )
+                    family( variant );
+            }
+        }
+
+        bool passed = expect( strays != 0 && strayed != 0, "some trusses stray from their plan" );
+
+        const char* const names[] = { "scalar", "avx2", "avx512" };
+
+        TrussBatch::Instructions original = TrussBatch::instructions;
+        for( unsigned int set = TrussBatch::SCALAR; set <= TrussBatch::supported(); ++set )
+        {
+            TrussBatch::instructions = (TrussBatch::Instructions)set;
+
+            std::vector<Inspected> batched( trusses );
+            std::vector<Inspected> scalar( trusses );
+            std::vector<Truss*> pointers( batched.size() );
+            for( size_t i = 0; i < batched.size(); ++i )
+                pointers[i] = &batched[i];
+
+            TrussBatch::solve( pointers.data(), middles.data(), pointers.size() );
+
+            bool same = true;
+            for( size_t i = 0; i < scalar.size() && same; ++i )
+            {
+                scalar[i].solve( middles[i] );
+
+                same = batched[i]._forces.size() == scalar[i]._forces.size() && batched[i]._weakest == scalar[i]._weakest &&
+                       batched[i]._weakestMember == scalar[i]._weakestMember;
+                for( size_t f = 0; f < scalar[i]._forces.size() && same; ++f )
+                    same = batched[i]._forces[f] == scalar[i]._forces[f];
+            }
+
+            passed &= expect( same, ("the batched solve the same as the scalar one with " + std::string( names[set] )).c_str() );
+        }
+        TrussBatch::instructions = original;
+
+        return passed;
+    }
+
+    // A truss with the nodes at the given x (and y of 0 and 20 in turn), each joined to the next
+    Truss       chain( const std::vector<double>& xs )
+    {
+        Truss truss;
+        for( size_t i = 0; i < xs.size(); ++i )
+            truss.insert( Node( xs[i], (i % 2) * 20.0 ) );
+        for( NodeIndex i = 1; i < truss.nodes.size(); ++i )
+            truss.connect( i - 1, i, 1.0 );
+        return truss;
+    }
+
+    // Packing has to put every node within half a step of where it was (in a box across the truss, 65535 steps
+    //  wide) unless it has to be moved off the step of the node before, keep x strictly increasing, and give back
+    //  exactly the same bytes when what it unpacks to is packed again
+    bool        packedTrussRoundTrip()
+    {
+        const double STEPS = 65535.0;
+        const Truss examples[] = { Examples::exa(), Examples::exb(), Examples::prebuilt() };
+        Random::Generator random( 13 );
+
+        std::vector<Truss> trusses( std::begin( examples ), std::end( examples ) );
+        for( unsigned int e = 0; e < 3; ++e )
+        {
+            for( unsigned int v = 0; v < 2000; ++v )
+            {
+                Random::Generator stream = random.split( e * 2000 + v );
+                Truss variant( examples[e] );
+                for( unsigned int m = 0; m < 3; ++m )
+                    Truss::mutation( stream.gen( (unsigned int)Truss::MUTATIONS ) )( &variant, stream );
+                trusses.push_back( variant );
+            }
+        }
+
+        bool passed = true;
+        for( auto truss = trusses.begin(); truss != trusses.end() && passed; ++truss )
+        {
+            PackedTruss packed( *truss );
+            Truss unpacked = packed.unpack();
+
+            passed &= expect( unpacked.nodes.size() == truss->nodes.size() && unpacked.connections.size() == truss->connections.size(), "as many nodes and members" );
+            if( !passed )
+                break;
+
+            double bottom = truss->nodes[0].y, top = bottom;
+            for( auto n = truss->nodes.begin(); n != truss->nodes.end(); ++n )
+            {
+                bottom = std::min( bottom, n->y );
+                top = std::max( top, n->y );
+            }
+            // Half a step, allowing for the box's corner and step being floats
+            double left = truss->nodes.front().x, right = truss->nodes.back().x;
+            double halfX = 0.5 * (right - left + fabs( left ) * 2e-7) / STEPS * (1.0 + 1e-6);
+            double halfY = 0.5 * (top - bottom + fabs( bottom ) * 2e-7) / STEPS * (1.0 + 1e-6);
+
+            for( size_t i = 0; i < truss->nodes.size(); ++i )
+            {
+                // A node that rounds onto the x of the one before moves a step on, and so on down a run of them
+                size_t crowded = 0;
+                for( size_t j = i; j > 0 && truss->nodes[j].x - truss->nodes[j - 1].x < 4.0 * halfX; --j )
+                    crowded++;
+
+                passed &= expect( fabs( unpacked.nodes[i].x - truss->nodes[i].x ) <= halfX * (1 + 2 * crowded) && fabs( unpacked.nodes[i].y - truss->nodes[i].y ) <= halfY,
+                                  "every node within half a step" );
+                passed &= expect( i == 0 || unpacked.nodes[i - 1].x < unpacked.nodes[i].x, "x strictly increasing" );
+            }
+
+            for( size_t i = 0; i < truss->connections.size(); ++i )
+            {
+                const Connection& a = truss->connections[i];
+                const Connection& b = unpacked.connections[i];
+                passed &= expect( a.a == b.a && a.b == b.b && a.thickness == b.thickness, "the members as they were" );
+            }
+            passed &= expect( unpacked.thicknessSum == truss->thicknessSum && unpacked.memberCount == truss->memberCount, "the stick and member counts as they were" );
+
+            PackedTruss repacked( unpacked );
+            std::vector<char> first, second;
+            unpacked.write( first );
+            repacked.unpack().write( second );
+            passed &= expect( repacked.bytes() == packed.bytes() && repacked.hash() == packed.hash() && first == second, "packing what was unpacked changes nothing" );
+        }
+
+        // Nodes closer together in x than a step, at the start, in the middle and against the end of the box, all
+        //  have to come back apart and in order
+        const double crowded[][6] = { { -231.0, -230.9999, -230.9998, 0.0, 100.0, 231.0 }, { -231.0, -0.0002, -0.0001, 0.0, 0.0001, 231.0 },
+                                      { -231.0, 0.0, 230.9997, 230.9998, 230.9999, 231.0 } };
+        for( auto xs = std::begin( crowded ); xs != std::end( crowded ); ++xs )
+        {
+            Truss truss = chain( std::vector<double>( std::begin( *xs ), std::end( *xs ) ) );
+            PackedTruss packed( truss );
+            Truss unpacked = packed.unpack();
+
+            bool apart = unpacked.nodes.size() == truss.nodes.size();
+            for( size_t i = 0; apart && i < unpacked.nodes.size(); ++i )
+                apart = (i == 0 || unpacked.nodes[i - 1].x < unpacked.nodes[i].x) && fabs( unpacked.nodes[i].x - truss.nodes[i].x ) < 0.1;
+            passed &= expect( apart, "crowded nodes kept apart and in order" );
+
+            PackedTruss repacked( unpacked );
+            passed &= expect( repacked.hash() == packed.hash(), "packing crowded nodes that were unpacked changes nothing" );
+        }
+
+        // Too many nodes for a byte to count
+        std::vector<double> xs( 256 );
+        for( size_t i = 0; i < xs.size(); ++i )
+            xs[i] = -231.0 + 1.8 * i;
+        bool thrown = false;
+        try
+        {
+            PackedTruss packed( chain( xs ) );
+        }
+        catch( const std::runtime_error& )
+        {
+            thrown = true;
+        }
+        passed &= expect( thrown, "a truss of 256 nodes can not be packed" );
+
+        // Never packed at all
+        PackedTruss empty;
+        Truss nothing = empty.unpack();
+        passed &= expect( nothing.nodes.empty() && nothing.connections.empty() && nothing.memberCount == 0 && nothing.thicknessSum == 0.0, "an empty PackedTruss unpacks to an empty truss" );
+
+        return passed;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    const char* filter = nullptr;
+    for( int i = 1; i < argc; ++i )
+    {
+        if( strcmp( argv[i], "--filter" ) == 0 && i + 1 < argc )
+            filter = argv[++i];
+    }
+
+    const Check checks[] =
+    {
+        { "ThreadPool::parallelFor/back to back", threadPoolBackToBack },
+        { "AliasSampling/uniform fitness", aliasSamplingUniform },
+        { "Truss::read/short and corrupt messages", trussReadRejects },
+        { "TrussBatch::solve/same as Truss::solve", trussBatchMatchesScalar },
+        { "PackedTruss/pack and unpack", packedTrussRoundTrip },
+    };
+
+    unsigned int failures = 0;
+    for( auto check = std::begin( checks ); check != std::end( checks ); ++check )
+    {
+        if( filter != nullptr && strstr( check->name, filter ) == nullptr )
+            continue;
+
+        bool passed = check->run();
+        fprintf( stderr, "%-48s %s\n", check->name, passed ? "passed" : "FAILED" );
+        failures += passed ? 0 : 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
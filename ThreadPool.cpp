@@ -0,0 +1,148 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool( unsigned int threads )
+    : _queued( 0 ), _remaining( 0 ), _stopping( false )
+{
+    if( threads == 0 )
+        threads = std::max( std::thread::hardware_concurrency(), 1u );
+
+    for( unsigned int i = 0; i < threads; ++i )
+        _queues.emplace_back( new Queue() );
+
+    // Worker 0 is whoever calls parallelFor
+    for( unsigned int i = 1; i < threads; ++i )
+        _threads.emplace_back( &ThreadPool::work, this, i );
+}
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( _lock );
+        _stopping = true;
+    }
+    _wake.notify_all();
+
+    for( auto i = _threads.begin(); i != _threads.end(); ++i )
+        i->join();
+}
+
+void    ThreadPool::parallelFor( size_t count, size_t grain, const Task& task )
+{
+    if( count == 0 )
+        return;
+
+    grain = std::max<size_t>( grain, 1 );
+
+    // Not worth waking anybody up for
+    if( size() == 1 || count <= grain )
+    {
+        for( size_t begin = 0; begin < count; begin += grain )
+            task( begin, std::min( count, begin + grain ), 0 );
+        return;
+    }
+
+    size_t chunks = (count + grain - 1) / grain;
+    unsigned int workers = size();
+
+    // Counted before any chunk goes on a queue, as a worker still looking for work from the last call can take one
+    //  the moment it is there
+    {
+        std::lock_guard<std::mutex> lock( _lock );
+        _remaining = chunks;
+        _queued = chunks;
+    }
+
+    // Hand each worker a contiguous block of chunks, so that neighbouring items stay on the same thread unless stolen
+    for( unsigned int w = 0; w < workers; ++w )
+    {
+        size_t first = (chunks * w) / workers;
+        size_t last = (chunks * (w + 1)) / workers;
+
+        std::lock_guard<std::mutex> lock( _queues[w]->lock );
+        for( size_t c = first; c < last; ++c )
+            _queues[w]->chunks.push_back( { c * grain, std::min( count, (c + 1) * grain ), &task } );
+    }
+
+    _wake.notify_all();
+
+    while( runChunk( 0 ) )
+        ;
+
+    std::unique_lock<std::mutex> lock( _lock );
+    _done.wait( lock, [this](){ return _remaining == 0; } );
+
+    if( _error )
+    {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception( error );
+    }
+}
+
+void    ThreadPool::work( unsigned int worker )
+{
+    while( true )
+    {
+        {
+            std::unique_lock<std::mutex> lock( _lock );
+            _wake.wait( lock, [this](){ return _stopping || _queued != 0; } );
+
+            if( _stopping )
+                return;
+        }
+
+        while( runChunk( worker ) )
+            ;
+    }
+}
+bool    ThreadPool::runChunk( unsigned int worker )
+{
+    Chunk chunk;
+    bool found = false;
+
+    // Our own work comes off the front, stolen work off the back
+    for( unsigned int i = 0; i < size() && !found; ++i )
+    {
+        Queue& queue = *_queues[(worker + i) % size()];
+        std::lock_guard<std::mutex> lock( queue.lock );
+
+        if( queue.chunks.empty() )
+            continue;
+
+        if( i == 0 )
+        {
+            chunk = queue.chunks.front();
+            queue.chunks.pop_front();
+        }
+        else
+        {
+            chunk = queue.chunks.back();
+            queue.chunks.pop_back();
+        }
+        _queued--;
+        found = true;
+    }
+
+    if( !found )
+        return false;
+
+    try
+    {
+        (*chunk.task)( chunk.begin, chunk.end, worker );
+    }
+    catch( ... )
+    {
+        std::lock_guard<std::mutex> lock( _lock );
+        if( !_error )
+            _error = std::current_exception();
+    }
+
+    if( --_remaining == 0 )
+    {
+        std::lock_guard<std::mutex> lock( _lock );
+        _done.notify_all();
+    }
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+
+// A fixed set of worker threads that run ranges of work with work stealing.
+// The thread calling parallelFor takes part as worker 0, so a pool of size 1 spawns no threads at all.
+class ThreadPool
+{
+public:
+    // Called with the range [begin, end) to process and the index of the worker running it
+    typedef std::function<void( size_t begin, size_t end, unsigned int worker )> Task;
+public:
+    // A thread count of 0 uses every hardware thread
+    ThreadPool( unsigned int threads = 0 );
+    ~ThreadPool();
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator =( const ThreadPool& ) = delete;
+
+    unsigned int    size() const
+    {
+        return (unsigned int)_queues.size();
+    }
+
+    // Splits [0, count) into chunks of at most grain items and blocks until every chunk has been run.
+    // Chunks always start on a multiple of grain, however many threads there are, so work can be keyed by chunk.
+    // Each worker starts on its own contiguous share of chunks and steals from the back of the others once it runs out.
+    // The first exception thrown by a chunk is rethrown here once all the work is done.
+    void            parallelFor( size_t count, size_t grain, const Task& task );
+private:
+    struct Chunk
+    {
+        size_t          begin;
+        size_t          end;
+        const Task*     task;
+    };
+    struct Queue
+    {
+        std::mutex          lock;
+        std::deque<Chunk>   chunks;
+    };
+
+    void            work( unsigned int worker );
+    // Runs one chunk from our own queue, or one stolen from another worker. Returns false if there were none left.
+    bool            runChunk( unsigned int worker );
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread>            _threads;
+
+    std::mutex                          _lock;
+    std::condition_variable             _wake;
+    std::condition_variable             _done;
+
+    std::atomic<size_t>                 _queued;
+    std::atomic<size_t>                 _remaining;
+    std::exception_ptr                  _error;
+    bool                                _stopping;
+};
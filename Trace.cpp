@@ -0,0 +1,106 @@
+#include "Trace.h"
+
+#if TRACING
+
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+using namespace Trace;
+
+thread_local bool   Trace::detailed = false;
+
+namespace
+{
+    struct Event
+    {
+        const char*     name;
+        uint64_t        start;
+        uint64_t        end;
+    };
+    struct Buffer
+    {
+        unsigned int        thread;
+        std::vector<Event>  events;
+        uint64_t            dropped;
+    };
+
+    // Buffers stay here after their thread has finished, so that nothing is lost before the next write
+    std::mutex                              registryLock;
+    std::vector<std::unique_ptr<Buffer>>    registry;
+
+    thread_local Buffer*                    local = nullptr;
+
+    // Where the ticks and the clock both started, to work out how long a tick is when writing
+    struct Origin
+    {
+        uint64_t                                ticks;
+        std::chrono::steady_clock::time_point   time;
+    };
+    const Origin        origin = { Trace::now(), std::chrono::steady_clock::now() };
+
+    Buffer*     registerThread()
+    {
+        std::lock_guard<std::mutex> lock( registryLock );
+
+        registry.emplace_back( new Buffer() );
+        registry.back()->thread = (unsigned int)registry.size();
+        registry.back()->dropped = 0;
+        // Growing as we go would copy the whole buffer every so often. Pages that are never used are never touched.
+        registry.back()->events.reserve( CAPACITY );
+
+        return registry.back().get();
+    }
+}
+
+void    Trace::record( const char* name, uint64_t start, uint64_t end )
+{
+    if( local == nullptr )
+        local = registerThread();
+
+    if( local->events.size() < CAPACITY )
+        local->events.push_back( { name, start, end } );
+    else
+        local->dropped++;
+}
+
+bool    Trace::write( const char* path )
+{
+    FILE* file = fopen( path, "w" );
+    if( file == nullptr )
+        return false;
+
+    uint64_t ticks = now();
+    double elapsed = std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - origin.time ).count();
+    double ticksPerMicrosecond = elapsed > 0.0 ? (ticks - origin.ticks) / elapsed : 1.0;
+
+    std::lock_guard<std::mutex> lock( registryLock );
+
+    uint64_t dropped = 0;
+    bool first = true;
+
+    fprintf( file, "{\"traceEvents\":[\n" );
+    for( auto i = registry.begin(); i != registry.end(); ++i )
+    {
+        Buffer& buffer = **i;
+
+        for( auto e = buffer.events.begin(); e != buffer.events.end(); ++e )
+        {
+            fprintf( file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", e->name, buffer.thread, (e->start - origin.ticks) / ticksPerMicrosecond, (e->end - e->start) / ticksPerMicrosecond );
+            first = false;
+        }
+
+        dropped += buffer.dropped;
+
+        buffer.events.clear();
+        buffer.dropped = 0;
+    }
+    fprintf( file, "\n],\"otherData\":{\"dropped\":%llu}}\n", (unsigned long long)dropped );
+
+    return fclose( file ) == 0;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+// Spans of time spent in each part of the program, written out in the Chrome trace format (which both Perfetto and
+//  chrome://tracing read). Build with TRACING defined as 1 to turn it on, otherwise every macro here is empty.
+#ifndef TRACING
+#define TRACING 0
+#endif
+
+#if TRACING
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#elif defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace Trace
+{
+    // Spans kept per thread. Any more than that are counted, but dropped.
+    const size_t    CAPACITY = 1 << 21;
+    // Spans inside the work on a single item (a mutation, a fitness evaluation) are only kept for one item in this
+    //  many. Timing every one would cost more than the work itself is worth tracing for.
+    const size_t    DETAIL_EVERY = 16;
+
+    // Whether the item this thread is working on is one of those being traced in detail
+    extern thread_local bool    detailed;
+
+    // In ticks of the time stamp counter where there is one, which is far cheaper to read than a clock
+    inline uint64_t now()
+    {
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+    }
+
+    // Adds a span to this thread's buffer. The name is kept as it is, so it must be a string literal.
+    void            record( const char* name, uint64_t start, uint64_t end );
+    // Writes every span so far out to path, and empties the buffers. No spans can be open on other threads meanwhile.
+    bool            write( const char* path );
+
+    class Span
+    {
+    public:
+        explicit Span( const char* name )
+            : _name( name ), _start( now() )
+        {
+        }
+        ~Span()
+        {
+            record( _name, _start, now() );
+        }
+
+        Span( const Span& ) = delete;
+        Span& operator =( const Span& ) = delete;
+    private:
+        const char*     _name;
+        uint64_t        _start;
+    };
+
+    // A span that is only kept when the current item is traced in detail
+    class DetailSpan
+    {
+    public:
+        explicit DetailSpan( const char* name )
+            : _name( detailed ? name : nullptr ), _start( detailed ? now() : 0 )
+        {
+        }
+        ~DetailSpan()
+        {
+            if( _name != nullptr )
+                record( _name, _start, now() );
+        }
+
+        DetailSpan( const DetailSpan& ) = delete;
+        DetailSpan& operator =( const DetailSpan& ) = delete;
+    private:
+        const char*     _name;
+        uint64_t        _start;
+    };
+}
+
+#define TRACE_JOIN_LINE( a, b )     a##b
+#define TRACE_JOIN( a, b )          TRACE_JOIN_LINE( a, b )
+
+// Times the rest of the enclosing scope
+#define TRACE_SPAN( name )          Trace::Span TRACE_JOIN( traceSpan, __LINE__ )( name )
+// The same, but within the work on one item, see DETAIL_EVERY
+#define TRACE_DETAIL( name )        Trace::DetailSpan TRACE_JOIN( traceSpan, __LINE__ )( name )
+// Marks the start of the work on an item, picking it out by its index for detailed tracing or not
+#define TRACE_ITEM( index )         (Trace::detailed = (index) % Trace::DETAIL_EVERY == 0)
+#define TRACE_WRITE( path )         Trace::write( path )
+
+#else
+
+#define TRACE_SPAN( name )
+#define TRACE_DETAIL( name )
+#define TRACE_ITEM( index )
+#define TRACE_WRITE( path )
+
+#endif
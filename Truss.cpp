@@ -1,36 +1,54 @@
 #include "Truss.h"
 #include "Random.h"
+#include "Equilibrium.h"
+#include "Trace.h"
+#include "TrussBatch.h"
+#include "Counters.h"
 
 #include <algorithm>
-#include <map>
+#include <stdexcept>
+#include <string.h>
+#include <vector>
 
-const unsigned int MAXIMUM_CALCULATION_PASSES = 21;
-const double FITNESS_INTENSITY = 3.0; // This is the intensity mentioned in the workbook
+// Only optimised builds get away without this, as InlineVector takes the value it fills with by reference
+const NodeIndex Truss::NO_NODE;
 
-void    calculateForce( const Force& t, Force& a, Force& b )
+Truss::Solver   Truss::solver = Truss::METHOD_OF_JOINTS;
+double          Truss::fitnessIntensity = 3.0;
+unsigned int    Truss::mutationWeights[Truss::MUTATIONS] = { 1, 1, 1, 2 };
+std::vector<Truss::LoadCase>    Truss::loadCases;
+
+Truss::LoadCase     Truss::LoadCase::distributed( double from, double to, double total, unsigned int points )
+{
+    LoadCase distributed;
+    for( unsigned int i = 0; i < points; ++i )
+    {
+        Load load;
+        load.position = points == 1 ? (from + to) / 2.0 : from + (to - from) * i / (points - 1);
+        load.magnitude = total / points;
+        distributed.loads.push_back( load );
+    }
+    return distributed;
+}
+
+static void    calculateForce( const Force& t, Force& a, Force& b )
 {
     a.mag = (b.y * (t.x * t.mag) - b.x * (t.y * t.mag)) / (b.x * a.y - b.y * a.x);
     b.mag = -(a.mag * a.x + (t.mag * t.x)) / b.x;
 }
-Vector  formVector( const Truss::Member& member, NodeIterator from )
+static inline Vector  formVector( const NodeList& nodes, const Truss::Member& member, NodeIndex from )
 {
-    Vector v;
     if( member.nodeA == from )
-    {
-        v.x = member.nodeB->x - from->x;
-        v.y = member.nodeB->y - from->y;
-    }
+        return nodes[member.nodeB] - nodes[from];
     else
-    {
-        v.x = member.nodeA->x - from->x;
-        v.y = member.nodeA->y - from->y;
-    }
-    return v;
+        return nodes[member.nodeA] - nodes[from];
 }
 
 // For now it works, though there are some potential improvements with a lot of work
-void                Truss::create( const Truss& a, const Truss& b, bool side )
+void                Truss::create( const Truss& a, const Truss& b, bool side, Random::Generator& random )
 {
+    TRACE_DETAIL( "Truss::create" );
+
     // Determine the sides on which to swap
     const Truss* left;
     const Truss* right;
@@ -46,43 +64,71 @@ void                Truss::create( const Truss& a, const Truss& b, bool side )
     }
 
     // Split down the middle
-    auto leftMiddle = left->findMiddle();
-    auto rightMiddle = right->findMiddle();
+    NodeIndex leftMiddle = left->findMiddle();
+    NodeIndex rightMiddle = right->findMiddle();
 
-    if( leftMiddle == left->nodes.end() || rightMiddle == right->nodes.end() )
-        throw std::exception( "Error: Trying to construct a truss using at least one invalid parent (the parent's middle node can't be found)" );
+    if( leftMiddle == NO_NODE || rightMiddle == NO_NODE )
+        throw std::runtime_error( "Error: Trying to construct a truss using at least one invalid parent (the parent's middle node can't be found)" );
+
+    double centre = right->nodes[rightMiddle].x;
 
     // Ensure that the structures do not overlap
-    while( std::prev( leftMiddle )->x >= rightMiddle->x )
-        std::advance( leftMiddle, -1 );
+    while( leftMiddle > 0 && left->nodes[leftMiddle - 1].x >= centre )
+        leftMiddle--;
+
+    // Every left node is now strictly left of every right node, so the two halves can be laid down one after the other
+    nodes.assign( left->nodes.begin(), left->nodes.begin() + leftMiddle );
+    nodes.insert( nodes.end(), right->nodes.begin() + rightMiddle, right->nodes.end() );
+    _laidOut = false;
+
+    connections.clear();
+    memberCount = 0;
+    thicknessSum = 0.0;
+    changed( TOPOLOGY );
+
+    // Keep only the members that lie entirely within each half. Both lists are sorted, and every left index is
+    //  below every right index, so the result is sorted too.
+    for( auto i = left->connections.begin(); i != left->connections.end(); ++i )
+    {
+        if( i->b >= leftMiddle )
+            continue;
 
-    // Just to make sure
-    nodes.clear();
+        connections.push_back( *i );
+        memberCount++;
+        thicknessSum += i->thickness;
+    }
+    for( auto i = right->connections.begin(); i != right->connections.end(); ++i )
+    {
+        if( i->a < rightMiddle )
+            continue;
 
-    auto leftLast = copy( left->nodes, left->nodes.begin(), leftMiddle );
-    copy( right->nodes, rightMiddle, right->nodes.end() );
+        connections.push_back( { i->a - rightMiddle + leftMiddle, i->b - rightMiddle + leftMiddle, i->thickness } );
+        memberCount++;
+        thicknessSum += i->thickness;
+    }
 
-    auto newMiddle = findMiddle();
+    NodeIndex newMiddle = middle();
 
     // Deleting nodes with 0 connections
-    for( auto i = nodes.begin(); i != nodes.end(); )
-    {
-        if( i->connected.size() == 0 )
-            i = nodes.erase( i );
-        else
-            ++i;
-    }
+    newMiddle = eraseUnconnected( newMiddle );
+
+    NodeIndices connected;
+    unsigned int passes = 0;
 
     // Now we need to look for all missing connections and try to reconnect them.
     for( unsigned int counter = 0; counter < MAXIMUM_CALCULATION_PASSES; ++counter )
     {
-        for( auto i = nodes.begin(); i != nodes.end(); )
+        passes++;
+
+        for( NodeIndex i = 0; i < nodes.size(); )
         {
-            if( determinancy() == 0 && i->connected.size() != 1 )
+            neighbours( i, connected );
+
+            if( determinancy() == 0 && connected.size() != 1 )
                 break;
 
             // Check whether the node can be connected with an item on the other side
-            if( fabs( i->x - rightMiddle->x ) > MAX_MEMBER_LENGTH )
+            if( fabs( nodes[i].x - centre ) > MAX_MEMBER_LENGTH )
             {
                 ++i;
                 continue;
@@ -90,9 +136,9 @@ void                Truss::create( const Truss& a, const Truss& b, bool side )
 
             // If they arent connected to any item 50mm closer to the centre, add another connection
             int connectedChance = 10;
-            for( auto j = i->connected.begin(); j != i->connected.end(); ++j )
+            for( auto j = connected.begin(); j != connected.end(); ++j )
             {
-                if( fabs( j->node->x - rightMiddle->x ) < 100.0 )
+                if( fabs( nodes[*j].x - centre ) < 100.0 )
                 {
                     connectedChance -= 5;
                     break;
@@ -102,18 +148,19 @@ void                Truss::create( const Truss& a, const Truss& b, bool side )
             if( determinancy() > 0 )
                 connectedChance = -1000;
 
-            connectedChance -= ((int)i->connected.size() - 2)*2;
+            connectedChance -= ((int)connected.size() - 2)*2;
 
-            if( i->connected.size() == 1 )
+            if( connected.size() == 1 )
                 connectedChance += 100;
 
             // There are two more factors to consider: Determinancy and number of connections
             if( connectedChance < -100 && i != newMiddle )
             {
-                // Disconnect whole node which will automatically delete it
-                for( int j = (int)i->connected.size() - 1; j >= 0; --j )
-                    disconnect( i, i->connected[j].node );
+                // Disconnect whole node and delete it, along with any neighbour that is left stranded
+                for( int j = (int)connected.size() - 1; j >= 0; --j )
+                    disconnect( i, connected[j] );
 
+                newMiddle = eraseUnconnected( newMiddle );
                 break;
             }
 
@@ -123,14 +170,18 @@ void                Truss::create( const Truss& a, const Truss& b, bool side )
                 continue;
             }
 
-            if( Random::gen(10) <= (unsigned int)connectedChance )
+            if( random.gen(10) <= (unsigned int)connectedChance )
             {
-                for( auto j = nodes.begin(); j != nodes.end(); ++j )
+                // Only nodes this close in x can be close enough to connect to
+                auto window = nearby( i, MAX_MEMBER_LENGTH );
+                for( NodeIndex j = window.first; j < window.second; ++j )
                 {
+                    if( i == j || distance( nodes[j], nodes[i] ) > MAX_MEMBER_LENGTH )
+                        continue;
+
                     // This will determine whether or not the node on this side is connecting to a node on the other side of the middle
-                    bool sides = ((j->x >= rightMiddle->x) ^ (i->x >= rightMiddle->x)) || (Random::gen(30) <= (unsigned int)connectedChance );
-                    if( distance( *j, *i ) <= MAX_MEMBER_LENGTH && (sides || j == newMiddle) &&
-                        (std::find( j->connected.begin(), j->connected.end(), i ) == j->connected.end() && &*i != &*j) )
+                    bool sides = ((nodes[j].x >= centre) ^ (nodes[i].x >= centre)) || (random.gen(30) <= (unsigned int)connectedChance );
+                    if( (sides || j == newMiddle) && std::find( connected.begin(), connected.end(), j ) == connected.end() )
                     {
                         connect( i, j, 1.0 );
                         break;
@@ -144,34 +195,128 @@ void                Truss::create( const Truss& a, const Truss& b, bool side )
         if( determinancy() == 0 )
             break;
     }
+
+    Counters::add( Counters::CREATES );
+    Counters::add( Counters::RECONNECTION_PASSES, passes );
+
+    // A child that came out the same as one of its parents can carry on from that parent's solve
+    const Truss* parents[] = { left, right };
+    for( const Truss* parent : parents )
+    {
+        if( parent->_solvedMiddle != NO_NODE && parent->_change <= THICKNESS && sameAs( *parent ) )
+        {
+            _forces = parent->_forces;
+            _solvedMiddle = parent->_solvedMiddle;
+            _weakest = parent->_weakest;
+            _weakestMember = parent->_weakestMember;
+            _change = UNCHANGED;
+            break;
+        }
+    }
+}
+bool                Truss::sameAs( const Truss& truss ) const
+{
+    return nodes.size() == truss.nodes.size() && connections.size() == truss.connections.size() &&
+        memcmp( nodes.data(), truss.nodes.data(), nodes.size() * sizeof( Node ) ) == 0 &&
+        memcmp( connections.data(), truss.connections.data(), connections.size() * sizeof( Connection ) ) == 0;
 }
 
 double              Truss::fitness()
 {
-    if( determinancy() != 0 || thicknessSum > 23.0 || nodes.size() == 0 )
+    TRACE_DETAIL( "Truss::fitness" );
+
+    NodeIndex middle = loadedMiddle();
+
+    if( middle == NO_NODE )
         return 0.0;
 
+    solve( middle );
+
+    return score();
+}
+void                Truss::evaluate( Truss* const* trusses, size_t count, double* fitness )
+{
+    TRACE_DETAIL( "Truss::evaluate" );
+
+    // Reused from call to call, as the threads of the algorithm keep on coming back here
+    thread_local std::vector<Truss*>    pending;
+    thread_local std::vector<NodeIndex> middles;
+    thread_local std::vector<size_t>    indices;
+
+    pending.clear();
+    middles.clear();
+    indices.clear();
+
+    // Anything that needs no solve, or can only be solved by the equilibrium matrix, is done here
+    bool batching = solver == METHOD_OF_JOINTS;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        Truss* truss = trusses[i];
+        NodeIndex middle = truss->loadedMiddle();
+
+        if( middle == NO_NODE )
+            fitness[i] = 0.0;
+        else if( !batching || truss->solvedAt( middle ) )
+        {
+            truss->solve( middle );
+            fitness[i] = truss->score();
+        }
+        else
+        {
+            pending.push_back( truss );
+            middles.push_back( middle );
+            indices.push_back( i );
+        }
+    }
+
+    TrussBatch::solve( pending.data(), middles.data(), pending.size() );
+
+    for( size_t i = 0; i < pending.size(); ++i )
+        fitness[indices[i]] = pending[i]->score();
+}
+NodeIndex           Truss::loadedMiddle()
+{
+    Counters::add( Counters::EVALUATIONS );
+
+    if( determinancy() != 0 || nodes.size() == 0 )
+    {
+        Counters::add( Counters::REJECTED_DETERMINANCY );
+        return NO_NODE;
+    }
+    if( thicknessSum > 23.0 )
+    {
+        Counters::add( Counters::REJECTED_THICKNESS );
+        return NO_NODE;
+    }
+
     // Check the dimensions
-    double length = distance( *nodes.rbegin(), *nodes.begin() );
-    double lowest = std::min_element( nodes.begin(), nodes.end(), []( const Node& a, const Node& b ){ return a.y < b.y; } )->y;
+    const Layout& layout = this->layout();
 
-    if( !(length < (MAX_TRUSS_LENGTH) && length > (MAX_TRUSS_LENGTH - 10.0)  && lowest > -135.0) )
-        return 0.0;
+    if( !(layout.span < (MAX_TRUSS_LENGTH) && layout.span > (MAX_TRUSS_LENGTH - 10.0)) )
+    {
+        Counters::add( Counters::REJECTED_SPAN );
+        return NO_NODE;
+    }
+    if( !(layout.lowest > -135.0) )
+    {
+        Counters::add( Counters::REJECTED_LOWEST );
+        return NO_NODE;
+    }
+
+    // The middle node that will directly carry the weight
+    if( layout.middle == NO_NODE )
+        Counters::add( Counters::REJECTED_NO_MIDDLE );
 
+    return layout.middle;
+}
+double              Truss::score() const
+{
     // Give them 10 points for surviving this far. Congratulations!
     double fitness = 10.0;
 
-    // Find the middle node that will directly carry the weight
-    NodeIterator middle = findMiddle();
-
-    if( middle == nodes.end() )
-        return 0.0;
-
-    auto members = calculateSafeties( findMiddle() );
-    auto minElement = std::min_element( members.begin(), members.end(), []( const Truss::Safety& a, const Truss::Safety& b ){ return a.maxForce < b.maxForce; } );
-   
-    if( fabs( minElement->maxForce ) > DBL_EPSILON )
-        fitness += pow( minElement->maxForce / 10.0, FITNESS_INTENSITY);
+    if( fabs( _weakest ) > DBL_EPSILON )
+        fitness += pow( _weakest / 10.0, fitnessIntensity );
 
     //if( thicknessSum != 0 )
         //fitness += 4000.0 / thicknessSum;
@@ -179,146 +324,565 @@ double              Truss::fitness()
     return fitness;
 }
 
-Truss::Safeties     Truss::calculateSafeties( NodeIterator middle )
+static inline uint64_t  hashIn( uint64_t hash, uint64_t value )
 {
-    Members members = calculateMembers( middle, 1.0 );
-    Safeties safeties( members.size() );
-    
-    unsigned int count = 0;
-    for( auto i = members.begin(); i != members.end(); (++i), (++count) )
+    value *= 0x87C37B91114253D5ull;
+    value = (value << 31) | (value >> 33);
+    hash ^= value * 0x4CF5AD432745937Full;
+    return ((hash << 27) | (hash >> 37)) * 5 + 0x52DCE729;
+}
+static inline uint64_t  hashIn( uint64_t hash, double value )
+{
+    // Adding 0 turns -0.0 into 0.0, so the two hash the same
+    value += 0.0;
+
+    uint64_t bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+    return hashIn( hash, bits );
+}
+uint64_t            Truss::hash() const
+{
+    uint64_t hash = hashIn( (uint64_t)nodes.size(), (uint64_t)connections.size() );
+
+    for( auto i = nodes.begin(); i != nodes.end(); ++i )
     {
-        safeties[count].nodeA = i->nodeA;
-        safeties[count].nodeB = i->nodeB;
+        hash = hashIn( hash, i->x );
+        hash = hashIn( hash, i->y );
+    }
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        hash = hashIn( hash, ((uint64_t)i->a << 32) | i->b );
+        hash = hashIn( hash, i->thickness );
+    }
+    hash = hashIn( hash, thicknessSum );
 
-        safeties[count].forceProportion = i->force;
-        safeties[count].thickness = i->thickness;
+    // Finish off so that every bit of the input reaches the low bits the cache indexes with
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
 
-        if( i->force < 0.0 )
-        {
-            safeties[count].maxForce = -MAXIMUM_COMPRESSION( i->thickness, distance( *i->nodeA, *i->nodeB ) ) / i->force;
-            safeties[count].tension = false;
-        }
-        else
-        {
-            safeties[count].maxForce = MAXIMUM_TENSION / i->force;
-            safeties[count].tension = true;
-        }
+    return hash;
+}
+
+template <typename T>
+static inline void  writeRaw( std::vector<char>& message, const T* data, size_t count )
+{
+    const char* bytes = reinterpret_cast<const char*>( data );
+    message.insert( message.end(), bytes, bytes + count * sizeof( T ) );
+}
+template <typename T>
+static inline bool  readRaw( const char*& in, const char* end, T* data, size_t count )
+{
+    if( (size_t)(end - in) < count * sizeof( T ) )
+        return false;
+
+    memcpy( data, in, count * sizeof( T ) );
+    in += count * sizeof( T );
+    return true;
+}
+void                Truss::write( std::vector<char>& message ) const
+{
+    uint32_t counts[2] = { (uint32_t)nodes.size(), (uint32_t)connections.size() };
+
+    writeRaw( message, counts, 2 );
+    writeRaw( message, nodes.data(), nodes.size() );
+    writeRaw( message, connections.data(), connections.size() );
+}
+bool                Truss::read( const char*& in, const char* end )
+{
+    const char* start = in;
+    uint32_t counts[2];
+    if( !readRaw( start, end, counts, 2 ) )
+        return false;
+
+    // The counts are only believed once the bytes are there for them, so that a short or corrupt message can not ask
+    //  for gigabytes. In 64 bits, so that the sum can not wrap.
+    if( (uint64_t)counts[0] * sizeof( Node ) + (uint64_t)counts[1] * sizeof( Connection ) > (uint64_t)(end - start) )
+        return false;
+
+    const char* nodeBytes = start;
+    const char* connectionBytes = nodeBytes + counts[0] * sizeof( Node );
+
+    // Checked where they lie before any of it is copied in, so that a truss that fails to read is left as it was.
+    // Whatever arrives has to keep the same order as a truss built here.
+    Node previousNode;
+    for( uint32_t i = 0; i < counts[0]; ++i )
+    {
+        Node node;
+        memcpy( &node, nodeBytes + i * sizeof( Node ), sizeof( Node ) );
+
+        if( i > 0 && !(previousNode.x < node.x) )
+            return false;
+        previousNode = node;
+    }
+
+    Connection previousConnection;
+    int members = 0;
+    double thickness = 0.0;
+    for( uint32_t i = 0; i < counts[1]; ++i )
+    {
+        Connection connection;
+        memcpy( &connection, connectionBytes + i * sizeof( Connection ), sizeof( Connection ) );
+
+        if( connection.a >= connection.b || connection.b >= counts[0] || (i > 0 && !(previousConnection < connection)) )
+            return false;
+        previousConnection = connection;
+
+        members++;
+        thickness += connection.thickness;
+    }
+
+    nodes.resize( counts[0] );
+    connections.resize( counts[1] );
+    readRaw( start, end, nodes.data(), nodes.size() );
+    readRaw( start, end, connections.data(), connections.size() );
+    in = start;
+
+    memberCount = members;
+    thicknessSum = thickness;
+    _laidOut = false;
+
+    changed( TOPOLOGY );
+    return true;
+}
+
+Truss::Safeties     Truss::calculateSafeties( NodeIndex middle )
+{
+    solve( middle );
+
+    Safeties safeties( connections.size() );
+    for( unsigned int i = 0; i < connections.size(); ++i )
+    {
+        safeties[i].nodeA = connections[i].a;
+        safeties[i].nodeB = connections[i].b;
+
+        safeties[i].forceProportion = _forces[i];
+        safeties[i].thickness = connections[i].thickness;
+
+        safeties[i].maxForce = capacity( i );
+        safeties[i].tension = !(_forces[i] < 0.0);
     }
 
     return safeties;
 }
-Truss::Members      Truss::calculateMembers( NodeIterator node, double magnitude )
+void                Truss::solve( NodeIndex middle )
 {
-    Members members;
-    members.reserve( memberCount );
-    std::vector<bool>   completeNodes( nodes.size() );
-    unsigned int complete = 0;
+    if( _solvedMiddle == middle && _change <= THICKNESS )
+    {
+        // setThickness has already kept the capacities up to date
+        _change = UNCHANGED;
+        return;
+    }
 
-    // Account for the fact that though on paper the truss may be tilted, in real life the first and final point
-    //  will be aligned orthogonal to gravity
-    Vector tilt;
-    tilt.x = nodes.rbegin()->x - nodes.begin()->x;
-    tilt.y = nodes.rbegin()->y - nodes.begin()->y;
-    
+    if( solver == EQUILIBRIUM_MATRIX )
+    {
+        // The load cases are solved from the same factorisation as the unit load
+        Equilibrium equilibrium;
+        solved( middle, calculateMembersDirectly( middle, 1.0, equilibrium ), &equilibrium );
+        return;
+    }
+
+    solved( middle, calculateMembers( middle, 1.0 ) );
+}
+void                Truss::solve( const SolvePlan& plan )
+{
+    if( solvedAt( plan.middle ) )
+    {
+        _change = UNCHANGED;
+        return;
+    }
+
+    solved( plan.middle, calculateMembers( plan, 1.0 ) );
+}
+void                Truss::solved( NodeIndex middle, const Members& members, Equilibrium* equilibrium )
+{
+    _forces.resize( members.size() );
+    for( unsigned int i = 0; i < members.size(); ++i )
+        _forces[i] = members[i].force;
+
+    _solvedMiddle = middle;
+    _change = UNCHANGED;
+
+    if( loadCases.empty() )
+        findWeakest();
+    else
+        solveLoadCases( equilibrium );
+}
+void                Truss::solveLoadCases( Equilibrium* equilibrium )
+{
+    unsigned int members = (unsigned int)connections.size();
+    unsigned int cases = (unsigned int)loadCases.size();
+
+    Equilibrium own;
+    if( equilibrium == nullptr || !equilibrium->factorised() )
+    {
+        equilibrium = &own;
+        equilibrium->factorise( nodes, connections );
+    }
+
+    // The most compressive and the most tensile force, which are all the capacity of a member depends on
+    _forces.resize( members );
+    _forces.resize( 3 * members, 0.0 );
+    Newton* compression = &_forces[members];
+    Newton* tension = &_forces[2 * members];
+
+    if( !equilibrium->factorised() )
+    {
+        // Like any other truss that can not be solved, it gets an impossible force
+        for( unsigned int i = 0; i < members; ++i )
+            tension[i] = DBL_MAX;
+
+        findWeakest();
+        return;
+    }
+
+    // How far along the span each node is, to share out the loads that fall between them
+    Vector tilt = nodes.back() - nodes.front();
     double span = tilt.length();
-    // Normalise
     tilt.x /= span;
     tilt.y /= span;
 
-    // Note the swap of x and y, as we are finding the direction of gravity, which is orthogonal (and the negative sign)
-    Vector gravity( tilt.y, -tilt.x );
+    InlineVector<double, INLINE_NODES> along( nodes.size() );
+    for( NodeIndex i = 0; i < nodes.size(); ++i )
+        along[i] = dot( nodes[i] - nodes.front(), tilt );
 
-    Vector leftDist = (*node) - (*nodes.begin()); // Vector subtraction
-    Vector rightDist = (*nodes.rbegin()) - (*node); // Vector subtraction
-    // Utilise the fact that the span will be equal to the distance between the two nodes
-    // Also utilise the fact that we can determine moments using the dot product of the vector difference and the tilt
-    //  (as the tilt is normal to gravity the force of gravity, i.e. magnitude, is preserved at its full value)
-    Force leftNodeForce( -magnitude * dot( rightDist, tilt ) / span, gravity );
-    Force rightNodeForce( -magnitude * dot( leftDist, tilt ) / span, gravity );
-    Force middleForce( magnitude, gravity );
-    
+    unsigned int size = 2 * (unsigned int)nodes.size();
+    const Vector& gravity = equilibrium->gravity();
 
-    // Fill every member with the correct item. As a result of this method,
-    //  the members will always have nodeA as the smaller of the two nodes,
-    //  and the elements are ordered by nodeA and then nodeB. (0, 1) < (0, 2) < (0, 3) < (1, 2)
-    for( auto i = nodes.begin(); i != nodes.end(); ++i )
+    InlineVector<double, 2 * INLINE_NODES * 8> loads( cases * size, 0.0 );
+    for( unsigned int c = 0; c < cases; ++c )
     {
-        for( auto j = i->connected.begin(); j != i->connected.end(); ++j )
+        double* caseLoads = &loads[c * size];
+        const std::vector<LoadCase::Load>& caseList = loadCases[c].loads;
+
+        for( auto load = caseList.begin(); load != caseList.end(); ++load )
         {
-            if( *j->node < *i )
-                continue;
+            // The nearest node on either side of the load, or the one node past the support it lies beyond
+            double position = load->position * span;
+            NodeIndex before = NO_NODE;
+            NodeIndex after = NO_NODE;
+            for( NodeIndex i = 0; i < nodes.size(); ++i )
+            {
+                if( along[i] <= position && (before == NO_NODE || along[i] > along[before]) )
+                    before = i;
+                if( along[i] >= position && (after == NO_NODE || along[i] < along[after]) )
+                    after = i;
+            }
+            if( before == NO_NODE )
+                before = after;
+            if( after == NO_NODE )
+                after = before;
 
-            Member m;
-            m.force = 0.0;
-            m.known = false;
-            m.nodeA = i;
-            m.nodeB = j->node;
-            m.thickness = j->thickness;
+            double share = before == after ? 1.0 : (along[after] - position) / (along[after] - along[before]);
 
-            members.push_back( m );
+            caseLoads[2 * before] += share * load->magnitude * gravity.x;
+            caseLoads[2 * before + 1] += share * load->magnitude * gravity.y;
+            caseLoads[2 * after] += (1.0 - share) * load->magnitude * gravity.x;
+            caseLoads[2 * after + 1] += (1.0 - share) * load->magnitude * gravity.y;
         }
     }
 
-    for( unsigned int i = 0; i < MAXIMUM_CALCULATION_PASSES && complete != nodes.size(); ++i )
+    InlineVector<double, INLINE_CONNECTIONS * 8> forces( cases * members );
+    equilibrium->solve( loads.data(), forces.data(), cases );
+
+    for( unsigned int c = 0; c < cases; ++c )
+    {
+        for( unsigned int i = 0; i < members; ++i )
+        {
+            compression[i] = std::min( compression[i], forces[c * members + i] );
+            tension[i] = std::max( tension[i], forces[c * members + i] );
+        }
+    }
+
+    findWeakest();
+}
+Newton              Truss::capacity( unsigned int connection ) const
+{
+    Newton weakest = capacity( connection, _forces[connection] );
+
+    // The worst of the load cases, when there are any
+    for( size_t i = connection + connections.size(); i < _forces.size(); i += connections.size() )
+        weakest = std::min( weakest, capacity( connection, _forces[i] ) );
+
+    return weakest;
+}
+Newton              Truss::capacity( unsigned int connection, Newton force ) const
+{
+    const Connection& con = connections[connection];
+
+    if( force < 0.0 )
+        return -MAXIMUM_COMPRESSION( con.thickness, distance( nodes[con.a], nodes[con.b] ) ) / force;
+    else if( force > 0.0 )
+        return MAXIMUM_TENSION / force;
+
+    // A member carrying nothing can never break (and a zero force may well be -0.0)
+    return DBL_MAX;
+}
+void                Truss::findWeakest()
+{
+    _weakest = DBL_MAX;
+    _weakestMember = 0;
+
+    for( unsigned int i = 0; i < connections.size(); ++i )
+    {
+        Newton maxForce = capacity( i );
+        if( maxForce < _weakest )
+        {
+            _weakest = maxForce;
+            _weakestMember = i;
+        }
+    }
+}
+Truss::Members      Truss::calculateMembers( NodeIndex node, double magnitude )
+{
+    TRACE_DETAIL( "Truss::calculateMembers" );
+
+    if( solver == EQUILIBRIUM_MATRIX )
+        return calculateMembersDirectly( node, magnitude );
+
+    SolvePlan plan;
+    if( node != NO_NODE && SolvePlans::find( (unsigned int)nodes.size(), connections, node, plan ) )
+        return calculateMembers( plan, magnitude );
+
+    return calculateMembersByTrial( node, magnitude );
+}
+Truss::Members      Truss::calculateMembers( const SolvePlan& plan, double magnitude )
+{
+    Members members = unknownMembers();
+
+    if( !plan.complete )
+    {
+        // Knowing the forces could only ever leave more joints unresolved
+        for( auto i = members.begin(); i != members.end(); ++i )
+            i->force = DBL_MAX;
+
+        Counters::add( Counters::SOLVES );
+        Counters::add( Counters::SOLVE_PASSES, plan.passes );
+        Counters::add( Counters::PASS_CAP_HITS );
+        Counters::add( Counters::UNSOLVABLE );
+        return members;
+    }
+
+    Force loads[SolvePlan::LOADS];
+    jointLoads( plan.middle, magnitude, loads );
+
+    // The same arithmetic as calculateNodeMembers, only without looking for the joints that can be resolved
+    for( unsigned int s = 0; s < plan.stepCount; ++s )
+    {
+        const SolvePlan::Step& step = plan.steps[s];
+        Force resultant = loads[step.load];
+
+        for( unsigned int k = step.firstKnown; k < step.firstKnown + step.knownCount; ++k )
+        {
+            const SolvePlan::Term& term = plan.terms[k];
+            resultant += Force( members[term.member].force, nodes[term.other] - nodes[step.node] );
+        }
+
+        // Something the plan expected to act on the joint cancelled out, which the trial handles differently
+        if( resultant.mag == 0 )
+            return calculateMembersByTrial( plan.middle, magnitude );
+
+        Force unknowns[2];
+        for( unsigned int u = 0; u < step.unknownCount; ++u )
+            unknowns[u] = Force( 0.0, nodes[step.unknowns[u].other] - nodes[step.node] );
+
+        if( step.unknownCount == 2 )
+        {
+            calculateForce( resultant, unknowns[0], unknowns[1] );
+            members[step.unknowns[0].member].force = unknowns[0].mag;
+            members[step.unknowns[1].member].force = unknowns[1].mag;
+        }
+        else if( step.unknownCount == 1 )
+            members[step.unknowns[0].member].force = -resultant.mag * dot( resultant, unknowns[0] );
+
+        for( unsigned int u = 0; u < step.unknownCount; ++u )
+            members[step.unknowns[u].member].known = true;
+    }
+
+    Counters::add( Counters::SOLVES );
+    Counters::add( Counters::SOLVE_PASSES, plan.passes );
+    return members;
+}
+Truss::Members      Truss::calculateMembersByTrial( NodeIndex node, double magnitude )
+{
+    Members members = unknownMembers();
+    InlineVector<bool, INLINE_NODES>   completeNodes( nodes.size(), false );
+    unsigned int complete = 0;
+
+    Force loads[SolvePlan::LOADS];
+    jointLoads( node, magnitude, loads );
+
+    unsigned int passes = 0;
+    for( ; passes < MAXIMUM_CALCULATION_PASSES && complete != nodes.size(); ++passes )
     {
         // Every pass go through the nodes and look for items
-        unsigned int k = 0;
-        for( NodeIterator j = nodes.begin(); j != nodes.end(); ++j, ++k )
+        for( NodeIndex j = 0; j < nodes.size(); ++j )
         {
-            if( completeNodes[k] )
+            if( completeNodes[j] )
                 continue;
 
-            Force initial; // Initialised to 0
+            Force initial = loads[SolvePlan::NO_LOAD];
 
             if( j == node )
-                initial += middleForce;
-            else if( j == nodes.begin() )
-                initial += leftNodeForce;
-            else if( j == std::prev( nodes.end() ) )
-                initial += rightNodeForce;
+                initial = loads[SolvePlan::MIDDLE_LOAD];
+            else if( j == 0 )
+                initial = loads[SolvePlan::LEFT_LOAD];
+            else if( j == nodes.size() - 1 )
+                initial = loads[SolvePlan::RIGHT_LOAD];
 
             bool success = calculateNodeMembers( members, j, initial );
 
             if( success )
             {
-                completeNodes[k] = true;
+                completeNodes[j] = true;
                 complete++;
             }
         }
     }
 
+    Counters::add( Counters::SOLVES );
+    Counters::add( Counters::SOLVE_PASSES, passes );
+
     if( complete != nodes.size() )
     {
         for( auto i = members.begin(); i != members.end(); ++i )
             i->force = DBL_MAX;
+
+        Counters::add( Counters::PASS_CAP_HITS );
+        Counters::add( Counters::UNSOLVABLE );
+    }
+
+    return members;
+}
+Truss::Members      Truss::unknownMembers() const
+{
+    Members members;
+    members.reserve( memberCount );
+
+    // Fill every member with the correct item. The connections are already sorted, so
+    //  the members will always have nodeA as the smaller of the two nodes,
+    //  and the elements are ordered by nodeA and then nodeB. (0, 1) < (0, 2) < (0, 3) < (1, 2)
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        Member m;
+        m.force = 0.0;
+        m.known = false;
+        m.nodeA = i->a;
+        m.nodeB = i->b;
+        m.thickness = i->thickness;
+
+        members.push_back( m );
     }
 
     return members;
 }
-bool                Truss::calculateNodeMembers( Members& members, NodeIterator it, Force initial )
+void                Truss::jointLoads( NodeIndex node, double magnitude, Force* loads ) const
 {
-    // Find the members
-    std::vector<std::pair<Members::iterator, Force>> unknowns;
-    unknowns.reserve( 2 );
+    // Account for the fact that though on paper the truss may be tilted, in real life the first and final point
+    //  will be aligned orthogonal to gravity
+    Vector tilt;
+    tilt.x = nodes.back().x - nodes.front().x;
+    tilt.y = nodes.back().y - nodes.front().y;
+    
+    double span = tilt.length();
+    // Normalise
+    tilt.x /= span;
+    tilt.y /= span;
+
+    // Note the swap of x and y, as we are finding the direction of gravity, which is orthogonal (and the negative sign)
+    Vector gravity( tilt.y, -tilt.x );
+
+    // A missing middle node carries no load, which leaves nothing to solve for
+    Vector loaded = node == NO_NODE ? nodes.front() : nodes[node];
+    Vector leftDist = loaded - nodes.front(); // Vector subtraction
+    Vector rightDist = nodes.back() - loaded; // Vector subtraction
+    // Utilise the fact that the span will be equal to the distance between the two nodes
+    // Also utilise the fact that we can determine moments using the dot product of the vector difference and the tilt
+    //  (as the tilt is normal to gravity the force of gravity, i.e. magnitude, is preserved at its full value)
+    Force leftNodeForce( -magnitude * dot( rightDist, tilt ) / span, gravity );
+    Force rightNodeForce( -magnitude * dot( leftDist, tilt ) / span, gravity );
+    Force middleForce( magnitude, gravity );
+
+    // Each starts off at 0, as the method of joints always did
+    for( unsigned int i = 0; i < SolvePlan::LOADS; ++i )
+        loads[i] = Force();
+
+    loads[SolvePlan::MIDDLE_LOAD] += middleForce;
+    loads[SolvePlan::LEFT_LOAD] += leftNodeForce;
+    loads[SolvePlan::RIGHT_LOAD] += rightNodeForce;
+}
+Truss::Members      Truss::calculateMembersDirectly( NodeIndex node, double magnitude )
+{
+    Equilibrium equilibrium;
+    return calculateMembersDirectly( node, magnitude, equilibrium );
+}
+Truss::Members      Truss::calculateMembersDirectly( NodeIndex node, double magnitude, Equilibrium& equilibrium )
+{
+    Members members( connections.size() );
+    for( unsigned int i = 0; i < connections.size(); ++i )
+    {
+        members[i].nodeA = connections[i].a;
+        members[i].nodeB = connections[i].b;
+        members[i].thickness = connections[i].thickness;
+        members[i].known = true;
+    }
+
+    Counters::add( Counters::SOLVES );
+
+    // Like the method of joints, anything that cannot be solved gets an impossible force
+    if( node == NO_NODE || !equilibrium.factorise( nodes, connections ) )
+    {
+        for( auto i = members.begin(); i != members.end(); ++i )
+            i->force = DBL_MAX;
+
+        Counters::add( Counters::UNSOLVABLE );
+
+        return members;
+    }
+
+    // The only load is on the middle node, the supports are part of the system
+    InlineVector<double, 2 * INLINE_NODES> loads( 2 * nodes.size(), 0.0 );
+    loads[2 * node] = magnitude * equilibrium.gravity().x;
+    loads[2 * node + 1] = magnitude * equilibrium.gravity().y;
+
+    InlineVector<double, INLINE_CONNECTIONS> forces( members.size() );
+    equilibrium.solve( loads.data(), forces.data() );
+
+    for( unsigned int i = 0; i < members.size(); ++i )
+        members[i].force = forces[i];
+
+    return members;
+}
+bool                Truss::calculateNodeMembers( Members& members, NodeIndex it, Force initial )
+{
+    // Find the members. Only two unknowns can be solved for, so there is no need to look any further once a third turns up.
+    std::pair<Members::iterator, Force> unknowns[2];
+    unsigned int unknownCount = 0;
 
     Force resultant = initial;
 
-    auto end = std::next( it );
-    for( auto i = members.begin(); i != members.end() && i->nodeA != end; ++i )
+    for( auto i = members.begin(); i != members.end() && i->nodeA <= it; ++i )
     {
         if( i->nodeA == it || i->nodeB == it )
         {
             if( i->known == false )
-                unknowns.push_back( { i, Force( 0.0, formVector( *i, it ) ) } );
+            {
+                if( unknownCount == 2 )
+                    return false;
+
+                unknowns[unknownCount++] = { i, Force( 0.0, formVector( nodes, *i, it ) ) };
+            }
             else
-                resultant += Force( i->force, formVector( *i, it ) );
+                resultant += Force( i->force, formVector( nodes, *i, it ) );
         }
     }
 
-    if( unknowns.size() > 2 || resultant.mag == 0 )
+    if( resultant.mag == 0 )
         return false;
 
-    if( unknowns.size() == 2 )
+    if( unknownCount == 2 )
     {
         calculateForce( resultant, unknowns[0].second, unknowns[1].second );
         unknowns[0].first->force = unknowns[0].second.mag;
@@ -326,87 +890,244 @@ bool                Truss::calculateNodeMembers( Members& members, NodeIterator
         unknowns[1].first->force = unknowns[1].second.mag;
         unknowns[1].first->known = true;
     }
-    else if( unknowns.size() == 1 )
+    else if( unknownCount == 1 )
     {
-        unknowns[0].first->force = -resultant.mag;
+        // The member has to take the whole resultant, which pulls along it in tension and pushes against it in compression
+        unknowns[0].first->force = -resultant.mag * dot( resultant, unknowns[0].second );
+        unknowns[0].first->known = true;
     }
     
     return true;
 }
 
-NodeIterator        Truss::copy( const NodeSet& set, NodeIterator start, NodeIterator end )
+std::pair<NodeIndex, bool>  Truss::insert( const Node& node )
 {
-    if( start == set.end() )
-        return nodes.end();
-    // Create one so we know the nodeset contains items
-    Node n;
-    n.x = start->x;
-    n.y = start->y;
+    auto position = std::lower_bound( nodes.begin(), nodes.end(), node );
+    NodeIndex index = (NodeIndex)(position - nodes.begin());
+
+    if( position != nodes.end() && position->x == node.x )
+        return { index, false };
 
-    auto ourStart = nodes.insert( n ).first;
-    for( auto i = std::next( start ); i != end; ++i )
+    nodes.insert( position, node );
+    _laidOut = false;
+    changed( TOPOLOGY );
+
+    // Shifting every index at or after the new node keeps the connections in order
+    for( auto i = connections.begin(); i != connections.end(); ++i )
     {
-        Node n;
-        n.x = i->x;
-        n.y = i->y;
-        
-        auto nodeIt = nodes.insert( n ).first;
+        if( i->a >= index )
+            i->a++;
+        if( i->b >= index )
+            i->b++;
+    }
 
-        // Add members
-        for( auto j = i->connected.begin(); j != i->connected.end(); ++j )
-        {
-            // Add it only if the previous node was already added
-            if( *i < *(j->node) || *(j->node) < *start )
-                continue;
+    return { index, true };
+}
+NodeIndex           Truss::move( NodeIndex node, const Vector& position )
+{
+    Node moved( position.x, position.y );
 
-            // Find the previous node
-            auto otherNode = std::next( ourStart, std::distance( start, j->node ) );
+    auto found = std::lower_bound( nodes.begin(), nodes.end(), moved );
+    if( found != nodes.end() && found->x == moved.x )
+        return NO_NODE;
 
-            connect( nodeIt, otherNode, j->thickness );
-        }
+    NodeIndex index = (NodeIndex)(found - nodes.begin());
+    // The node itself is leaving its old place, so anything beyond it comes back one
+    if( index > node )
+        index--;
+
+    if( index < node )
+        std::rotate( nodes.begin() + index, nodes.begin() + node, nodes.begin() + node + 1 );
+    else if( index > node )
+        std::rotate( nodes.begin() + node, nodes.begin() + node + 1, nodes.begin() + index + 1 );
+
+    nodes[index] = moved;
+    _laidOut = false;
+    changed( GEOMETRY );
+
+    if( index == node )
+        return index;
+
+    auto remap = [node, index]( NodeIndex i ) -> NodeIndex
+    {
+        if( i == node )
+            return index;
+        if( node < index && i > node && i <= index )
+            return i - 1;
+        if( index < node && i >= index && i < node )
+            return i + 1;
+        return i;
+    };
+
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        i->a = remap( i->a );
+        i->b = remap( i->b );
+
+        if( i->a > i->b )
+            std::swap( i->a, i->b );
     }
-    return std::prev( nodes.end() );
+    std::sort( connections.begin(), connections.end() );
+
+    return index;
 }
-void                Truss::connect( NodeIterator a, NodeIterator b, double thickness )
+NodeIndex           Truss::eraseUnconnected( NodeIndex track )
 {
-    a->connected.push_back( { thickness, b } );
-    b->connected.push_back( { thickness, a } );
+    InlineVector<bool, INLINE_NODES> connected( nodes.size(), false );
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        connected[i->a] = true;
+        connected[i->b] = true;
+    }
+
+    // Compact the nodes down, keeping how far each one moved
+    NodeIndices remap( nodes.size(), NO_NODE );
+    NodeIndex kept = 0;
+    for( NodeIndex i = 0; i < nodes.size(); ++i )
+    {
+        if( !connected[i] )
+            continue;
+
+        remap[i] = kept;
+        nodes[kept++] = nodes[i];
+    }
+
+    if( kept == nodes.size() )
+        return track;
+
+    nodes.resize( kept );
+    _laidOut = false;
+    changed( TOPOLOGY );
+
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        i->a = remap[i->a];
+        i->b = remap[i->b];
+    }
+
+    return track == NO_NODE ? NO_NODE : remap[track];
+}
+void                Truss::connect( NodeIndex a, NodeIndex b, double thickness )
+{
+    if( a > b )
+        std::swap( a, b );
+
+    Connection con = { a, b, thickness };
+    connections.insert( std::upper_bound( connections.begin(), connections.end(), con ), con );
 
     memberCount++;
     thicknessSum += thickness;// *(distance( *a, *b ) / 150.0);
+
+    changed( TOPOLOGY );
 }
-void                Truss::disconnect( NodeIterator a, NodeIterator b )
+void                Truss::setThickness( unsigned int connection, double thickness )
 {
-    auto it = std::find_if( a->connected.begin(), a->connected.end(), [b]( Node::Connection& con ){ return con.node == b; } );
-    double thickness = it->thickness;// *(distance( *a, *b ) / 150.0);
-    a->connected.erase( it );
-    b->connected.erase( std::find_if( b->connected.begin(), b->connected.end(), [a]( Node::Connection& con ){ return con.node == a; } ) );
+    thicknessSum += thickness - connections[connection].thickness;
+    connections[connection].thickness = thickness;
+
+    changed( THICKNESS );
 
-    if( a->connected.size() == 0 )
-        nodes.erase( a );
-    if( b->connected.size() == 0 )
-        nodes.erase( b );
+    if( _solvedMiddle == NO_NODE )
+        return;
+
+    // The forces still stand, so only this member's capacity needs working out again. Only when the weakest
+    //  member gets stronger does every member have to be looked at.
+    Newton maxForce = capacity( connection );
+    if( maxForce < _weakest )
+    {
+        _weakest = maxForce;
+        _weakestMember = connection;
+    }
+    else if( connection == _weakestMember )
+        findWeakest();
+}
+void                Truss::disconnect( NodeIndex a, NodeIndex b )
+{
+    Connection* con = findConnection( a, b );
+    double thickness = con->thickness;// *(distance( *a, *b ) / 150.0);
+    connections.erase( connections.begin() + (con - connections.data()) );
 
     thicknessSum -= thickness;
 
     memberCount--;
+
+    changed( TOPOLOGY );
 }
-NodeIterator        Truss::findMiddle() const
+Connection*         Truss::findConnection( NodeIndex a, NodeIndex b )
 {
-    auto i = nodes.begin();
-    Vector tilt = *nodes.rbegin() - *nodes.begin();
+    if( a > b )
+        std::swap( a, b );
+
+    Connection con = { a, b, 0.0 };
+    auto found = std::lower_bound( connections.begin(), connections.end(), con );
+
+    if( found == connections.end() || found->a != a || found->b != b )
+        return nullptr;
+    return &*found;
+}
+unsigned int        Truss::connectionCount( NodeIndex node ) const
+{
+    unsigned int count = 0;
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        if( i->touches( node ) )
+            count++;
+    }
+    return count;
+}
+void                Truss::neighbours( NodeIndex node, NodeIndices& neighbours ) const
+{
+    neighbours.clear();
+    for( auto i = connections.begin(); i != connections.end(); ++i )
+    {
+        if( i->touches( node ) )
+            neighbours.push_back( i->other( node ) );
+    }
+}
+std::pair<NodeIndex, NodeIndex>     Truss::nearby( NodeIndex node, double reach ) const
+{
+    double x = nodes[node].x;
+
+    NodeIndex first = node;
+    while( first > 0 && x - nodes[first - 1].x <= reach )
+        first--;
+
+    NodeIndex last = node + 1;
+    while( last < nodes.size() && nodes[last].x - x <= reach )
+        last++;
+
+    return { first, last };
+}
+const Truss::Layout&    Truss::layout()
+{
+    if( _laidOut )
+        return _layout;
+
+    _layout.middle = findMiddle();
+    _layout.span = nodes.empty() ? 0.0 : distance( nodes.back(), nodes.front() );
+    _layout.lowest = nodes.empty() ? 0.0 : std::min_element( nodes.begin(), nodes.end(), []( const Node& a, const Node& b ){ return a.y < b.y; } )->y;
+    _laidOut = true;
+
+    return _layout;
+}
+NodeIndex           Truss::findMiddle() const
+{
+    if( _laidOut )
+        return _layout.middle;
+
+    Vector tilt = nodes.back() - nodes.front();
     double span = tilt.length();
 
     tilt.x /= span;
     tilt.y /= span;
 
-    for( i; i != nodes.end(); ++i )
+    for( NodeIndex i = 0; i < nodes.size(); ++i )
     {
-        double a = dot( (*i - *nodes.begin()), tilt );
-        double b = dot( (*nodes.rbegin() - *i), tilt );
+        double a = dot( (nodes[i] - nodes.front()), tilt );
+        double b = dot( (nodes.back() - nodes[i]), tilt );
 
         if( fabs( a - b ) < 5.0 )
             return i;
     }
-    return nodes.end();
-}
\ No newline at end of file
+    return NO_NODE;
+}
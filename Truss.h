@@ -1,10 +1,13 @@
 #pragma once
 
-#include <set>
+#include <vector>
 #include <algorithm>
 
 #include "GeneticItem.h"
 #include "Node.h"
+#include "SolvePlan.h"
+
+class Equilibrium;
 
 struct Truss : GeneticItem<Truss>
 {
@@ -17,26 +20,26 @@ public:
         }
 
         Newton          force;
-        NodeIterator    nodeA;
-        NodeIterator    nodeB;
+        NodeIndex       nodeA;
+        NodeIndex       nodeB;
         bool            known;
         double          thickness;
     };
-    typedef std::vector<Member> Members;
+    typedef InlineVector<Member, INLINE_CONNECTIONS> Members;
 
     struct Safety
     {
         Newton          maxForce;
         bool            tension;
 
-        NodeIterator    nodeA;
-        NodeIterator    nodeB;
+        NodeIndex       nodeA;
+        NodeIndex       nodeB;
 
         double          forceProportion;
 
         double          thickness;
     };
-    typedef std::vector<Safety> Safeties;
+    typedef InlineVector<Safety, INLINE_CONNECTIONS> Safeties;
 
     static constexpr double		MAX_TRUSS_LENGTH = 465.0;
     static constexpr double		MAX_MEMBER_LENGTH = 150.0;
@@ -46,50 +49,197 @@ public:
         return (740000.0 / (length * length)) * (thickness > 1.1 ? (thickness > 2.1 ? 26.0 : 8.0) : 1.0);
     }
 	static const unsigned int	MAX_THICKNESS = 6; // Maximum thickness of sum of members at a node.
-public:   
-    Truss()
-        : memberCount( 0 ), thicknessSum( 0.0 )
-    {
-    }
-    Truss( const Truss& truss )
-        : memberCount( 0 ), thicknessSum( 0.0 )
+
+    // Returned in place of a node index when there is no such node
+    static const NodeIndex      NO_NODE = ~0u;
+
+    enum Solver
     {
-        copy( truss.nodes, truss.nodes.begin(), truss.nodes.end() );
-    }
-    Truss&  operator =( const Truss& truss )
+        METHOD_OF_JOINTS,       // Resolves joints with at most two unknown members, pass after pass
+        EQUILIBRIUM_MATRIX      // Factorises the equilibrium equations of every joint at once, see Equilibrium.h
+    };
+    // The solver used by calculateMembers, shared by every truss. Only change it while nothing is being evaluated.
+    static Solver               solver;
+    // How heavily the capacity of the weakest member counts towards fitness (the intensity mentioned in the workbook)
+    static double               fitnessIntensity;
+    // Relative chances of addNode, removeNode, thicken and moveNode being picked, in that order (see Scheduler.h)
+    static const unsigned int   MUTATIONS = 4;
+    static unsigned int         mutationWeights[MUTATIONS];
+
+    // Loads a truss has to carry at once, each at a point along its span (0 at the left support, 1 at the right)
+    //  and as a multiple of the unit load at the middle. A load that falls between nodes is shared between the
+    //  nearest node either side, as it would be by a deck resting on them.
+    struct LoadCase
     {
-        memberCount = 0;
-        thicknessSum = 0.0;
-        nodes.clear();
+        struct Load
+        {
+            double      position;
+            double      magnitude;
+        };
+        std::vector<Load>   loads;
+
+        // total spread evenly over points loads from one position to another
+        static LoadCase     distributed( double from, double to, double total, unsigned int points );
+    };
+    // Cases checked as well as the unit load at the middle, a truss being only as strong as it is in the worst of
+    //  them. They are all solved from one factorisation of the equilibrium equations, see Equilibrium.h. Only
+    //  change them while nothing is being evaluated.
+    static std::vector<LoadCase>    loadCases;
 
-        copy( truss.nodes, truss.nodes.begin(), truss.nodes.end() );
-        
-        return *this;
+    // What has been done to a truss since it was last solved, from the least to the most disruptive
+    enum Change
+    {
+        UNCHANGED,
+        THICKNESS,      // Only thicknesses changed: every member force still stands, just those members' capacity moves
+        GEOMETRY,       // Nodes moved. In a determinate truss that shifts the load through every member, so it is solved again.
+        TOPOLOGY        // Nodes or members were added or removed
+    };
+public:   
+    Truss()
+        : memberCount( 0 ), thicknessSum( 0.0 ), _solvedMiddle( NO_NODE ), _weakest( 0.0 ), _weakestMember( 0 ), _change( TOPOLOGY ), _edits( 0 ), _laidOut( false )
+    {
     }
+    // Everything is held inline, so a move costs the same as a copy unless a list has spilled onto the heap
+    Truss( const Truss& truss ) = default;
+    Truss( Truss&& truss ) = default;
+    Truss&          operator =( const Truss& truss ) = default;
+    Truss&          operator =( Truss&& truss ) = default;
 
-    void            create( const Truss& a, const Truss& b, bool side );
+    void            create( const Truss& a, const Truss& b, bool side, Random::Generator& random );
 
     double          fitness();
+    // The same as fitness() for each truss, with those that share a topology solved side by side, see TrussBatch.h
+    static void     evaluate( Truss* const* trusses, size_t count, double* fitness );
+    // Covers the geometry, the members and their thickness, and the stick count. The nodes and connections are
+    //  always kept sorted, so equal trusses hash equal however they were built.
+    uint64_t        hash() const;
+    // Only the nodes and connections are sent, in this machine's byte order. Everything else is rebuilt from them.
+    void            write( std::vector<char>& message ) const;
+    bool            read( const char*& in, const char* end );
+
+    // The mutations from Mutations.h, in the order of mutationWeights
+    static Mutation*    mutation( unsigned int index );
+
+    // Inserts the node in order of x, shifting the index of every node to its right along by one.
+    // Like a set, fails (returning the index of the existing node and false) if a node with the same x is already present.
+    std::pair<NodeIndex, bool>  insert( const Node& node );
+    // Moves a node, keeping its connections. Returns the node's new index, or NO_NODE if another node already has that x.
+    NodeIndex       move( NodeIndex node, const Vector& position );
+    // Erases every node left without a connection. Returns the new index of track (NO_NODE if it was erased).
+    NodeIndex       eraseUnconnected( NodeIndex track = NO_NODE );
+
+    void            connect( NodeIndex a, NodeIndex b, double thickness );
+    // Changes the thickness of connections[connection], keeping thicknessSum and the last solve up to date
+    void            setThickness( unsigned int connection, double thickness );
+    // Leaves the nodes in place even once they have no connections left; see eraseUnconnected
+    void            disconnect( NodeIndex a, NodeIndex b );
+
+    Connection*     findConnection( NodeIndex a, NodeIndex b );
+    unsigned int    connectionCount( NodeIndex node ) const;
+    // Fills neighbours with every node connected to the given one, in order of index
+    void            neighbours( NodeIndex node, NodeIndices& neighbours ) const;
+    // The nodes whose x is no further than reach from the given node's, as [first, second). Nodes are kept in order of
+    //  x, so these are the ones either side of it, and finding them takes as long as there are of them.
+    std::pair<NodeIndex, NodeIndex> nearby( NodeIndex node, double reach ) const;
+
+    NodeIndex       findMiddle() const;
+    // findMiddle, kept until the nodes next change
+    NodeIndex       middle()
+    {
+        return layout().middle;
+    }
 
-    void            connect( NodeIterator a, NodeIterator b, double thickness );
-    void            disconnect( NodeIterator a, NodeIterator b );
-
-    NodeIterator    findMiddle() const;
+    // Reuses the last solve when only thicknesses have changed since, see changes()
+    Safeties        calculateSafeties( NodeIndex middle );
 
-    Safeties        calculateSafeties( NodeIterator middle );
+    Change          changes() const
+    {
+        return _change;
+    }
+    // Goes up with every change made, so that a caller can tell whether anything was
+    unsigned int    edits() const
+    {
+        return _edits;
+    }
 
-    NodeSet         nodes;
+    // Sorted by x, and no two nodes share the same x
+    NodeList        nodes;
+    // Sorted by a then b
+    Connections     connections;
     int             memberCount;
     double          thicknessSum;
 protected:
-    Members         calculateMembers( NodeIterator node, double magnitude );
-    bool            calculateNodeMembers( Members& member, NodeIterator it, Force initial );
+    friend class TrussBatch;
+    friend class PackedTruss;
+
+    // The node the load hangs from, or NO_NODE if the truss can not be built (or can not carry it) at all
+    NodeIndex       loadedMiddle();
+    // The fitness of a truss that has been solved with the load at its loaded middle
+    double          score() const;
+    bool            solvedAt( NodeIndex middle ) const
+    {
+        return _solvedMiddle == middle && _change <= THICKNESS;
+    }
 
-    int             determinancy()
+    // Follows the plan for the topology when there is one, and only finds the order of the joints by trial otherwise
+    Members         calculateMembers( NodeIndex node, double magnitude );
+    Members         calculateMembers( const SolvePlan& plan, double magnitude );
+    Members         calculateMembersByTrial( NodeIndex node, double magnitude );
+    Members         calculateMembersDirectly( NodeIndex node, double magnitude );
+    Members         calculateMembersDirectly( NodeIndex node, double magnitude, Equilibrium& equilibrium );
+    // Every member, none of them known yet
+    Members         unknownMembers() const;
+    // The load on each SolvePlan::Load kind of joint before any member is counted
+    void            jointLoads( NodeIndex node, double magnitude, Force* loads ) const;
+    bool            calculateNodeMembers( Members& member, NodeIndex it, Force initial );
+
+    int             determinancy() const
     {
         return (int)(memberCount - ((nodes.size() * 2) - 3));
     }
 
-    // The method will also return the iterator of the last added element
-    NodeIterator    copy( const NodeSet& set, NodeIterator start, NodeIterator end );
+    // Makes sure _forces holds the member forces under a unit load at middle, only solving if the last solve is stale
+    void            solve( NodeIndex middle );
+    // The same, with the plan for this truss already to hand
+    void            solve( const SolvePlan& plan );
+    void            solved( NodeIndex middle, const Members& members, Equilibrium* equilibrium = nullptr );
+    // Adds the worst of loadCases to _forces and finds the weakest member again. equilibrium is used if it has
+    //  already been factorised for this truss.
+    void            solveLoadCases( Equilibrium* equilibrium );
+    // The lowest multiple of its load any case can put on the member before it breaks
+    Newton          capacity( unsigned int connection ) const;
+    Newton          capacity( unsigned int connection, Newton force ) const;
+    void            findWeakest();
+    void            changed( Change change )
+    {
+        _edits++;
+        if( change > _change )
+            _change = change;
+        if( change >= GEOMETRY )
+            _solvedMiddle = NO_NODE;
+    }
+    bool            sameAs( const Truss& truss ) const;
+
+    // What the nodes alone say about the truss, worked out the first time it is needed after they last changed.
+    //  Only ever filled in by a method that is not const, so that trusses being read are never written to (the
+    //  parents of create are read by several threads at once).
+    struct Layout
+    {
+        NodeIndex   middle;     // See findMiddle
+        double      span;       // From the first node to the last
+        double      lowest;     // The lowest y of any node
+    };
+    const Layout&   layout();
+
+    // The last solve, in the order of the connections. Only good while _solvedMiddle is set. With loadCases it is
+    //  followed by the most compressive and then the most tensile force each member sees in any case.
+    InlineVector<Newton, INLINE_CONNECTIONS>    _forces;
+    NodeIndex       _solvedMiddle;
+    // The lowest capacity of any member, and which member that is
+    Newton          _weakest;
+    unsigned int    _weakestMember;
+    Change          _change;
+    unsigned int    _edits;
+    Layout          _layout;
+    bool            _laidOut;
 };
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "TrussBatch.h"
+#include "Counters.h"
+
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <stdint.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+#define TRUSS_BATCH_X86 1
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#else
+#define TRUSS_BATCH_X86 0
+#endif
+
+namespace
+{
+    const unsigned int  MAX_WIDTH = 8;
+
+    bool        sameTopology( const Truss& a, NodeIndex aMiddle, const Truss& b, NodeIndex bMiddle )
+    {
+        if( aMiddle != bMiddle || a.nodes.size() != b.nodes.size() || a.connections.size() != b.connections.size() )
+            return false;
+
+        for( unsigned int i = 0; i < a.connections.size(); ++i )
+        {
+            if( a.connections[i].a != b.connections[i].a || a.connections[i].b != b.connections[i].b )
+                return false;
+        }
+        return true;
+    }
+
+    typedef unsigned int    Kernel( const SolvePlan& plan, const double* x, const double* y, const double* thickness,
+                                    double* forces, double* weakest, double* weakestMember );
+}
+
+// Each instruction set gets its own copy of the solve, compiled for that set alone. Only the one the processor has
+//  is ever called, so the rest of the program stays runnable anywhere.
+#if TRUSS_BATCH_X86
+
+#if defined( __clang__ )
+#pragma clang attribute push( __attribute__(( target( "avx2" ) )), apply_to = function )
+#elif defined( __GNUC__ )
+#pragma GCC push_options
+#pragma GCC target( "avx2" )
+#endif
+
+namespace avx2
+{
+    struct Lanes
+    {
+        static const unsigned int   WIDTH = 4;
+        typedef __m256d             Value;
+        typedef __m256d             Mask;
+
+        static inline Value         load( const double* p )             { return _mm256_loadu_pd( p ); }
+        static inline void          store( double* p, Value v )         { _mm256_storeu_pd( p, v ); }
+        static inline Value         set( double v )                     { return _mm256_set1_pd( v ); }
+
+        static inline Value         add( Value a, Value b )             { return _mm256_add_pd( a, b ); }
+        static inline Value         sub( Value a, Value b )             { return _mm256_sub_pd( a, b ); }
+        static inline Value         mul( Value a, Value b )             { return _mm256_mul_pd( a, b ); }
+        static inline Value         div( Value a, Value b )             { return _mm256_div_pd( a, b ); }
+        static inline Value         sqrt( Value v )                     { return _mm256_sqrt_pd( v ); }
+        static inline Value         neg( Value v )                      { return _mm256_xor_pd( v, _mm256_set1_pd( -0.0 ) ); }
+        static inline Value         abs( Value v )                      { return _mm256_andnot_pd( _mm256_set1_pd( -0.0 ), v ); }
+
+        static inline Mask          less( Value a, Value b )            { return _mm256_cmp_pd( a, b, _CMP_LT_OQ ); }
+        static inline Mask          greater( Value a, Value b )         { return _mm256_cmp_pd( a, b, _CMP_GT_OQ ); }
+        static inline Mask          greaterEqual( Value a, Value b )    { return _mm256_cmp_pd( a, b, _CMP_GE_OQ ); }
+        static inline Mask          equal( Value a, Value b )           { return _mm256_cmp_pd( a, b, _CMP_EQ_OQ ); }
+        // Where the mask is set a, otherwise b
+        static inline Value         select( Mask m, Value a, Value b )  { return _mm256_blendv_pd( b, a, m ); }
+        static inline unsigned int  bits( Mask m )                      { return (unsigned int)_mm256_movemask_pd( m ); }
+    };
+
+#include "TrussBatchKernel.h"
+}
+
+#if defined( __clang__ )
+#pragma clang attribute pop
+#pragma clang attribute push( __attribute__(( target( "avx512f" ) )), apply_to = function )
+#elif defined( __GNUC__ )
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target( "avx512f" )
+#endif
+
+namespace avx512
+{
+    struct Lanes
+    {
+        static const unsigned int   WIDTH = 8;
+        typedef __m512d             Value;
+        typedef __mmask8            Mask;
+
+        static inline Value         load( const double* p )             { return _mm512_loadu_pd( p ); }
+        static inline void          store( double* p, Value v )         { _mm512_storeu_pd( p, v ); }
+        static inline Value         set( double v )                     { return _mm512_set1_pd( v ); }
+
+        static inline Value         add( Value a, Value b )             { return _mm512_add_pd( a, b ); }
+        static inline Value         sub( Value a, Value b )             { return _mm512_sub_pd( a, b ); }
+        static inline Value         mul( Value a, Value b )             { return _mm512_mul_pd( a, b ); }
+        static inline Value         div( Value a, Value b )             { return _mm512_div_pd( a, b ); }
+        static inline Value         sqrt( Value v )                     { return _mm512_sqrt_pd( v ); }
+        // The floating point xor and and-not need AVX-512 DQ, the integer ones only F
+        static inline Value         neg( Value v )                      { return _mm512_castsi512_pd( _mm512_xor_si512( _mm512_castpd_si512( v ), _mm512_set1_epi64( INT64_MIN ) ) ); }
+        static inline Value         abs( Value v )                      { return _mm512_castsi512_pd( _mm512_andnot_si512( _mm512_set1_epi64( INT64_MIN ), _mm512_castpd_si512( v ) ) ); }
+
+        static inline Mask          less( Value a, Value b )            { return _mm512_cmp_pd_mask( a, b, _CMP_LT_OQ ); }
+        static inline Mask          greater( Value a, Value b )         { return _mm512_cmp_pd_mask( a, b, _CMP_GT_OQ ); }
+        static inline Mask          greaterEqual( Value a, Value b )    { return _mm512_cmp_pd_mask( a, b, _CMP_GE_OQ ); }
+        static inline Mask          equal( Value a, Value b )           { return _mm512_cmp_pd_mask( a, b, _CMP_EQ_OQ ); }
+        static inline Value         select( Mask m, Value a, Value b )  { return _mm512_mask_blend_pd( m, b, a ); }
+        static inline unsigned int  bits( Mask m )                      { return (unsigned int)m; }
+    };
+
+#include "TrussBatchKernel.h"
+}
+
+#if defined( __clang__ )
+#pragma clang attribute pop
+#elif defined( __GNUC__ )
+#pragma GCC pop_options
+#endif
+
+#endif
+
+TrussBatch::Instructions    TrussBatch::instructions = TrussBatch::supported();
+
+TrussBatch::Instructions    TrussBatch::supported()
+{
+#if TRUSS_BATCH_X86 && defined( __GNUC__ )
+    // Also checks that the operating system saves the wider registers
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx512f" ) )
+        return AVX512;
+    if( __builtin_cpu_supports( "avx2" ) )
+        return AVX2;
+#elif TRUSS_BATCH_X86 && defined( _MSC_VER )
+    int info[4];
+    __cpuid( info, 0 );
+    if( info[0] >= 7 )
+    {
+        __cpuid( info, 1 );
+        bool saved = (info[2] & (1 << 27)) != 0;
+        unsigned long long registers = saved ? _xgetbv( 0 ) : 0;
+
+        __cpuidex( info, 7, 0 );
+        if( (info[1] & (1 << 16)) != 0 && (registers & 0xE6) == 0xE6 )
+            return AVX512;
+        if( (info[1] & (1 << 5)) != 0 && (registers & 0x6) == 0x6 )
+            return AVX2;
+    }
+#endif
+    return SCALAR;
+}
+
+void                TrussBatch::solve( Truss* const* trusses, const NodeIndex* middles, size_t count )
+{
+    static const Instructions available = supported();
+
+    Kernel* kernel = nullptr;
+    unsigned int width = 1;
+#if TRUSS_BATCH_X86
+    switch( std::min( instructions, available ) )
+    {
+    case AVX512:
+        kernel = avx512::solvePlan;
+        width = avx512::Lanes::WIDTH;
+        break;
+    case AVX2:
+        kernel = avx2::solvePlan;
+        width = avx2::Lanes::WIDTH;
+        break;
+    default:
+        break;
+    }
+#endif
+
+    // Group the trusses by topology, keeping them in order within a group
+    thread_local std::vector<std::pair<uint64_t, size_t>> order;
+    order.resize( count );
+    for( size_t i = 0; i < count; ++i )
+        order[i] = { SolvePlan::fingerprint( (unsigned int)trusses[i]->nodes.size(), trusses[i]->connections, middles[i] ), i };
+
+    std::sort( order.begin(), order.end() );
+
+    SolvePlan plan;
+    alignas( 64 ) double x[SolvePlan::MAX_NODES * MAX_WIDTH];
+    alignas( 64 ) double y[SolvePlan::MAX_NODES * MAX_WIDTH];
+    alignas( 64 ) double thickness[SolvePlan::MAX_MEMBERS * MAX_WIDTH];
+    alignas( 64 ) double forces[SolvePlan::MAX_MEMBERS * MAX_WIDTH];
+    alignas( 64 ) double weakest[MAX_WIDTH];
+    alignas( 64 ) double weakestMember[MAX_WIDTH];
+
+    size_t group = 0;
+    while( group < count )
+    {
+        const Truss& first = *trusses[order[group].second];
+        NodeIndex middle = middles[order[group].second];
+
+        // Keys can collide, so the group only runs while the topology really is the same
+        size_t end = group + 1;
+        while( end < count && order[end].first == order[group].first && sameTopology( first, middle, *trusses[order[end].second], middles[order[end].second] ) )
+            ++end;
+
+        // The plan is looked up once for the whole group
+        if( !SolvePlans::find( order[group].first, (unsigned int)first.nodes.size(), first.connections, middle, plan ) )
+        {
+            for( size_t i = group; i < end; ++i )
+                trusses[order[i].second]->solve( middle );
+
+            group = end;
+            continue;
+        }
+
+        if( kernel == nullptr || end - group < 2 || !plan.complete )
+        {
+            for( size_t i = group; i < end; ++i )
+                trusses[order[i].second]->solve( plan );
+
+            group = end;
+            continue;
+        }
+
+        unsigned int solved = 0;
+        for( size_t batch = group; batch < end; batch += width )
+        {
+            unsigned int lanes = (unsigned int)std::min<size_t>( width, end - batch );
+
+            // Spare lanes repeat the first truss, and are thrown away
+            for( unsigned int lane = 0; lane < width; ++lane )
+            {
+                const Truss& truss = *trusses[order[batch + (lane < lanes ? lane : 0)].second];
+
+                for( unsigned int n = 0; n < plan.nodeCount; ++n )
+                {
+                    x[n * width + lane] = truss.nodes[n].x;
+                    y[n * width + lane] = truss.nodes[n].y;
+                }
+                for( unsigned int c = 0; c < plan.memberCount; ++c )
+                {
+                    thickness[c * width + lane] = truss.connections[c].thickness;
+                    forces[c * width + lane] = 0.0;
+                }
+            }
+
+            unsigned int strayed = kernel( plan, x, y, thickness, forces, weakest, weakestMember );
+
+            for( unsigned int lane = 0; lane < lanes; ++lane )
+            {
+                Truss& truss = *trusses[order[batch + lane].second];
+
+                if( (strayed & (1u << lane)) != 0 )
+                {
+                    truss.solve( plan );
+                    continue;
+                }
+
+                truss._forces.resize( plan.memberCount );
+                for( unsigned int c = 0; c < plan.memberCount; ++c )
+                    truss._forces[c] = forces[c * width + lane];
+
+                truss._solvedMiddle = middle;
+                truss._change = Truss::UNCHANGED;
+                truss._weakest = weakest[lane];
+                truss._weakestMember = (unsigned int)weakestMember[lane];
+
+                // The other load cases are not batched, as they need the whole equilibrium matrix
+                if( !Truss::loadCases.empty() )
+                    truss.solveLoadCases( nullptr );
+                solved++;
+            }
+        }
+
+        // Those that strayed counted themselves
+        Counters::add( Counters::SOLVES, solved );
+        Counters::add( Counters::SOLVE_PASSES, (uint64_t)solved * plan.passes );
+
+        group = end;
+    }
+}
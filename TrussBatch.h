@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "Truss.h"
+
+// Solves many trusses by the method of joints at once, several to a SIMD register.
+//
+// Once a population has settled, most of it shares a handful of topologies, differing only in where the nodes are
+//  and how thick the members are. Each group of trusses that share one looks its SolvePlan up once, then the plan is
+//  carried out for 4 (AVX2) or 8 (AVX-512) of them at a time with their geometry laid out lane by lane. The capacity
+//  of every member is worked out the same way.
+// Every lane does exactly the arithmetic Truss::solve would, in the same order, so the results are the same to the
+//  last bit. A truss whose forces happen to cancel out where the plan did not expect it (which would send Truss::solve
+//  down another path), or that has no other truss to share with, is solved on its own.
+class TrussBatch
+{
+public:
+    // Instruction sets the solve can use, from the least to the most capable
+    enum Instructions
+    {
+        SCALAR,         // One truss at a time, still only looking each plan up once
+        AVX2,
+        AVX512
+    };
+
+    // The most capable set this processor (and this build) has
+    static Instructions supported();
+    // The set in use. Starts off as supported(), and can be lowered to compare against the others.
+    static Instructions instructions;
+
+    // Solves each truss with the load at the matching middle, just as trusses[i]->solve( middles[i] ) would
+    static void         solve( Truss* const* trusses, const NodeIndex* middles, size_t count );
+};
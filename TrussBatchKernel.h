@@ -0,0 +1,186 @@
+// The lane by lane solve of TrussBatch.cpp, written once for any width of SIMD register.
+// TrussBatch.cpp includes this once per instruction set, each time inside a namespace of its own that defines Lanes
+//  for that set, which is why there is no #pragma once. Nothing here may call a function from outside that
+//  namespace, or it could end up compiled for an instruction set the processor does not have.
+//
+// Each function mirrors the scalar code it names operation for operation. Change one and the other has to follow.
+
+typedef Lanes::Value    Value;
+typedef Lanes::Mask     Mask;
+
+// A Force in every lane
+struct Forces
+{
+    Value       x;
+    Value       y;
+    Value       mag;
+};
+
+static inline Value     dot( Value ax, Value ay, Value bx, Value by )
+{
+    return Lanes::add( Lanes::mul( ax, bx ), Lanes::mul( ay, by ) );
+}
+static inline Value     length( Value x, Value y )
+{
+    return Lanes::sqrt( dot( x, y, x, y ) );
+}
+
+// Force( m, v )
+static inline Forces    makeForce( Value m, Value vx, Value vy )
+{
+    Forces f;
+
+    f.mag = length( vx, vy );
+    Mask small = Lanes::less( Lanes::abs( f.mag ), Lanes::set( DBL_EPSILON ) );
+    f.x = Lanes::select( small, vx, Lanes::div( vx, f.mag ) );
+    f.y = Lanes::select( small, vy, Lanes::div( vy, f.mag ) );
+
+    Mask positive = Lanes::greaterEqual( m, Lanes::set( 0.0 ) );
+    f.x = Lanes::select( positive, f.x, Lanes::neg( f.x ) );
+    f.y = Lanes::select( positive, f.y, Lanes::neg( f.y ) );
+    f.mag = Lanes::select( positive, m, Lanes::neg( m ) );
+
+    return f;
+}
+// Force::operator +=( const Force& )
+static inline void      addForce( Forces& r, const Forces& f )
+{
+    Value vx = Lanes::add( Lanes::mul( r.mag, r.x ), Lanes::mul( f.mag, f.x ) );
+    Value vy = Lanes::add( Lanes::mul( r.mag, r.y ), Lanes::mul( f.mag, f.y ) );
+
+    r.mag = length( vx, vy );
+    Mask small = Lanes::less( Lanes::abs( r.mag ), Lanes::set( DBL_EPSILON ) );
+    r.x = Lanes::select( small, r.x, Lanes::div( vx, r.mag ) );
+    r.y = Lanes::select( small, r.y, Lanes::div( vy, r.mag ) );
+}
+
+// Truss::calculateMembers following a plan, under a unit load, then Truss::findWeakest.
+// x and y hold the node coordinates and thickness the member thicknesses, lane after lane ([node * WIDTH + lane]).
+//  The member forces come back the same way, with the capacity of the weakest member in each lane and its index.
+// Returns a bit for each lane that strayed from the plan, and has to be solved on its own after all.
+static unsigned int     solvePlan( const SolvePlan& plan, const double* x, const double* y, const double* thickness,
+                                   double* forces, double* weakest, double* weakestMember )
+{
+    const unsigned int W = Lanes::WIDTH;
+    const unsigned int last = plan.nodeCount - 1;
+    const Value zero = Lanes::set( 0.0 );
+
+    Value frontX = Lanes::load( x );
+    Value frontY = Lanes::load( y );
+    Value backX = Lanes::load( x + last * W );
+    Value backY = Lanes::load( y + last * W );
+
+    Value tiltX = Lanes::sub( backX, frontX );
+    Value tiltY = Lanes::sub( backY, frontY );
+    Value span = length( tiltX, tiltY );
+    tiltX = Lanes::div( tiltX, span );
+    tiltY = Lanes::div( tiltY, span );
+
+    Value gravityX = tiltY;
+    Value gravityY = Lanes::neg( tiltX );
+
+    Value loadedX = Lanes::load( x + plan.middle * W );
+    Value loadedY = Lanes::load( y + plan.middle * W );
+    // Each support takes the share of the load given by the distance from the load to the other support
+    Value leftShare = dot( Lanes::sub( backX, loadedX ), Lanes::sub( backY, loadedY ), tiltX, tiltY );
+    Value rightShare = dot( Lanes::sub( loadedX, frontX ), Lanes::sub( loadedY, frontY ), tiltX, tiltY );
+
+    const Value negative = Lanes::set( -1.0 );
+    Forces loads[SolvePlan::LOADS];
+    loads[SolvePlan::NO_LOAD].x = zero;
+    loads[SolvePlan::NO_LOAD].y = zero;
+    loads[SolvePlan::NO_LOAD].mag = zero;
+    for( unsigned int i = SolvePlan::MIDDLE_LOAD; i < SolvePlan::LOADS; ++i )
+        loads[i] = loads[SolvePlan::NO_LOAD];
+
+    // Force initial; initial += nodeForce;
+    addForce( loads[SolvePlan::MIDDLE_LOAD], makeForce( Lanes::set( 1.0 ), gravityX, gravityY ) );
+    addForce( loads[SolvePlan::LEFT_LOAD], makeForce( Lanes::div( Lanes::mul( negative, leftShare ), span ), gravityX, gravityY ) );
+    addForce( loads[SolvePlan::RIGHT_LOAD], makeForce( Lanes::div( Lanes::mul( negative, rightShare ), span ), gravityX, gravityY ) );
+
+    unsigned int strayed = 0;
+
+    for( unsigned int s = 0; s < plan.stepCount; ++s )
+    {
+        const SolvePlan::Step& step = plan.steps[s];
+        Value nodeX = Lanes::load( x + step.node * W );
+        Value nodeY = Lanes::load( y + step.node * W );
+
+        Forces resultant = loads[step.load];
+        for( unsigned int k = step.firstKnown; k < step.firstKnown + step.knownCount; ++k )
+        {
+            const SolvePlan::Term& term = plan.terms[k];
+            Value vx = Lanes::sub( Lanes::load( x + term.other * W ), nodeX );
+            Value vy = Lanes::sub( Lanes::load( y + term.other * W ), nodeY );
+
+            addForce( resultant, makeForce( Lanes::load( forces + term.member * W ), vx, vy ) );
+        }
+
+        // The plan took it for granted that something acts on the joint
+        strayed |= Lanes::bits( Lanes::equal( resultant.mag, zero ) );
+
+        Forces unknowns[2];
+        for( unsigned int u = 0; u < step.unknownCount; ++u )
+        {
+            const SolvePlan::Term& term = step.unknowns[u];
+            Value vx = Lanes::sub( Lanes::load( x + term.other * W ), nodeX );
+            Value vy = Lanes::sub( Lanes::load( y + term.other * W ), nodeY );
+
+            unknowns[u] = makeForce( zero, vx, vy );
+        }
+
+        if( step.unknownCount == 2 )
+        {
+            // calculateForce
+            const Forces& a = unknowns[0];
+            const Forces& b = unknowns[1];
+            Value tx = Lanes::mul( resultant.x, resultant.mag );
+            Value ty = Lanes::mul( resultant.y, resultant.mag );
+
+            Value aMag = Lanes::div( Lanes::sub( Lanes::mul( b.y, tx ), Lanes::mul( b.x, ty ) ),
+                                     Lanes::sub( Lanes::mul( b.x, a.y ), Lanes::mul( b.y, a.x ) ) );
+            Value bMag = Lanes::div( Lanes::neg( Lanes::add( Lanes::mul( aMag, a.x ), Lanes::mul( resultant.mag, resultant.x ) ) ), b.x );
+
+            Lanes::store( forces + step.unknowns[0].member * W, aMag );
+            Lanes::store( forces + step.unknowns[1].member * W, bMag );
+        }
+        else if( step.unknownCount == 1 )
+        {
+            Value force = Lanes::mul( Lanes::neg( resultant.mag ), dot( resultant.x, resultant.y, unknowns[0].x, unknowns[0].y ) );
+            Lanes::store( forces + step.unknowns[0].member * W, force );
+        }
+    }
+
+    // Truss::capacity of every member, keeping the first of the weakest
+    Value weakestValue = Lanes::set( DBL_MAX );
+    Value weakestIndex = zero;
+
+    for( unsigned int c = 0; c < plan.memberCount; ++c )
+    {
+        Value force = Lanes::load( forces + c * W );
+        Value t = Lanes::load( thickness + c * W );
+
+        Value dx = Lanes::sub( Lanes::load( x + plan.memberA[c] * W ), Lanes::load( x + plan.memberB[c] * W ) );
+        Value dy = Lanes::sub( Lanes::load( y + plan.memberA[c] * W ), Lanes::load( y + plan.memberB[c] * W ) );
+        Value memberLength = length( dx, dy );
+
+        // MAXIMUM_COMPRESSION
+        Value factor = Lanes::select( Lanes::greater( t, Lanes::set( 1.1 ) ),
+                                      Lanes::select( Lanes::greater( t, Lanes::set( 2.1 ) ), Lanes::set( 26.0 ), Lanes::set( 8.0 ) ),
+                                      Lanes::set( 1.0 ) );
+        Value compression = Lanes::mul( Lanes::div( Lanes::set( 740000.0 ), Lanes::mul( memberLength, memberLength ) ), factor );
+
+        Value capacity = Lanes::select( Lanes::less( force, zero ), Lanes::div( Lanes::neg( compression ), force ),
+                                        Lanes::select( Lanes::greater( force, zero ), Lanes::div( Lanes::set( Truss::MAXIMUM_TENSION ), force ),
+                                                       Lanes::set( DBL_MAX ) ) );
+
+        Mask weaker = Lanes::less( capacity, weakestValue );
+        weakestValue = Lanes::select( weaker, capacity, weakestValue );
+        weakestIndex = Lanes::select( weaker, Lanes::set( (double)c ), weakestIndex );
+    }
+
+    Lanes::store( weakest, weakestValue );
+    Lanes::store( weakestMember, weakestIndex );
+
+    return strayed;
+}
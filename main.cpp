@@ -1,117 +1,511 @@
 #include "Genetic.h"
 #include "Truss.h"
+#include "PackedTruss.h"
 #include "Mutations.h"
 #include "Random.h"
+#include "Allocations.h"
+#include "Examples.h"
+#include "Island.h"
+#include "Snapshot.h"
+#include "Trace.h"
+#include "Batch.h"
+#include "Counters.h"
+#include "Stopping.h"
 
 #include <iostream>
 #include <fstream>
-#include <time.h>
+#include <string>
+#include <thread>
+#include <stdexcept>
+#include <chrono>
+#include <string.h>
+#include <stdlib.h>
 
-const unsigned int TIME = 600; // Time in seconds to run for.
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+const unsigned int TIME = 600; // Time in seconds to run for. Batches (see Batch.h) give their own, as they do the family size.
+// A run can also stop sooner: after GENERATIONS generations, after EVALUATIONS fitness evaluations (not counting those
+//  the cache answers), once the fittest reaches TARGET_FITNESS, or once neither the fittest nor the mean fitness has
+//  improved by more than STAGNATION_EPSILON in STAGNATION generations. 0 leaves any of them out. See Stopping.h.
+const uint64_t GENERATIONS = 0;
+const uint64_t EVALUATIONS = 0;
+const double TARGET_FITNESS = 0.0;
+const unsigned int STAGNATION = 0;
+const double STAGNATION_EPSILON = 1.0;
 // Normal family size is at 300. The larger values mean more randomness but potentially slower (only potentially due to an increase in convergence per iteration )
 const unsigned int FAMILY_SIZE = 500000;
+// Threads used for recombination and mutation. 0 uses every hardware thread.
+const unsigned int THREADS = 0;
+// How member forces are solved: Truss::METHOD_OF_JOINTS or Truss::EQUILIBRIUM_MATRIX (which also handles joints with three unknowns)
+const Truss::Solver SOLVER = Truss::METHOD_OF_JOINTS;
+// Loads every truss is checked under as well as the unit load at its middle, fitness going by the worst of them (see
+//  Truss::LoadCase). For example { { { { 0.25, 1.0 } } }, Truss::LoadCase::distributed( 0.0, 1.0, 2.0, 9 ) } adds a unit
+//  load a quarter of the way along and twice that spread evenly along the whole span.
+const std::vector<Truss::LoadCase> LOAD_CASES = {};
+// Entries in the table that lets identical trusses share one fitness evaluation. 0 evaluates every truss.
+const unsigned int FITNESS_CACHE = 1 << 20;
+// Bytes kept for the method of joints' plans, one for each topology it has come across (see SolvePlan.h). 0 plans every truss afresh.
+const size_t SOLVE_PLANS = 4 << 20;
+// How each child's mutation is chosen: MutationScheduler::FIXED, from Truss::mutationWeights, or ADAPTIVE, which starts
+//  from those and then favours whichever mutation has been gaining the most fitness per second (see Scheduler.h).
+//  Timings vary from run to run, so an ADAPTIVE run can not be repeated exactly from its seed.
+const MutationScheduler::Mode MUTATION_SCHEDULING = MutationScheduler::FIXED;
+// How parents are chosen: UNIVERSAL_SAMPLING, ALIAS_SAMPLING or TOURNAMENT (the fittest of TOURNAMENT_SIZE), see Selection.h
+const SelectionMethod SELECTION = UNIVERSAL_SAMPLING;
+const unsigned int TOURNAMENT_SIZE = 3;
+// How each generation is made: GENERATIONAL, or STEADY_STATE, where every worker breeds, evaluates and puts its own
+//  children back into the family without waiting on the others, replacing the least fit of TOURNAMENT_SIZE (see
+//  GeneticAlgorithm::steadyState). Parents are then picked by tournament whatever SELECTION is, and runs on more than
+//  one thread can not be repeated exactly from their seed.
+const GeneticAlgorithm<Truss>::Mode MODE = GeneticAlgorithm<Truss>::GENERATIONAL;
+// Number of populations run side by side, each FAMILY_SIZE / ISLANDS strong. 1 runs a single population.
+// Each island is its own process (a thread on Windows), passing copies of its MIGRANTS fittest on to the next
+//  island every MIGRATION_INTERVAL generations.
+const unsigned int ISLANDS = 1;
+const unsigned int MIGRATION_INTERVAL = 10;
+const unsigned int MIGRANTS = 20;
+// The population is saved here every SNAPSHOT_INTERVAL generations (0 only saves at the end), nullptr saving nothing.
+//  A run only carries on from a snapshot when given one with --resume, and then saves back to that file instead.
+//  Each island has a file of its own, numbered after this.
+const char* const SNAPSHOT = nullptr;
+const unsigned int SNAPSHOT_INTERVAL = 100;
+// What each generation ran into (see Counters.h) goes here as CSV, one line per generation. Each island has a file of
+//  its own, numbered after this, though on Windows the islands share a process and so share their counts. Empty, the
+//  default, writes nothing; Counters::total() still has the counts.
+const char* const COUNTERS = "";
+
+// What the population is kept as: Truss, or PackedTruss to fit several million in memory at the cost of unpacking each
+//  one to breed or evaluate it (see PackedTruss.h). PackedTruss rounds each node very slightly, so the same seed does
+//  not give the same run with both.
+typedef Truss Genome;
 
-GeneticAlgorithm<Truss> algorithm;
+typedef GeneticAlgorithm<Genome>::Item Result;
 
-int main()
+// The fittest item of a run, how many seconds into the run it turned up, and what brought the run to an end
+struct Outcome
 {
-    // Create example trusses
-    Truss exa;
-    {
-        auto a = exa.nodes.insert( Node( -231.0, 0.0 ) ).first;
-        auto b = exa.nodes.insert( Node( -112.5, 20.0 ) ).first;
-        auto c = exa.nodes.insert( Node( -100.0, -20.0 ) ).first;
-        auto d = exa.nodes.insert( Node( 0.0, -40.0 ) ).first;
-        auto e = exa.nodes.insert( Node( 10.0, 20.0 ) ).first;
-        auto f = exa.nodes.insert( Node( 100.0, -20.0 ) ).first;
-        auto g = exa.nodes.insert( Node( 112.5, 20.0 ) ).first;
-        auto h = exa.nodes.insert( Node( 231.0, 0.0 ) ).first;
-
-        exa.connect( a, b, 1.0 );
-        exa.connect( a, c, 1.0 );
-        exa.connect( b, e, 1.0 );
-        exa.connect( b, c, 1.0 );
-        exa.connect( c, d, 1.0 );
-        exa.connect( c, e, 1.0 );
-        exa.connect( d, e, 1.0 );
-        exa.connect( d, f, 1.0 );
-        exa.connect( e, f, 1.0 );
-        exa.connect( e, g, 1.0 );
-        exa.connect( f, g, 1.0 );
-        exa.connect( f, h, 1.0 );
-        exa.connect( g, h, 1.0 );
+    Result      best;
+    double      bestTime;
+    StoppingPolicy::Reason  stopped;
+    uint64_t    evaluations;
+};
+
+StoppingPolicy::Limits  stoppingLimits()
+{
+    StoppingPolicy::Limits limits = { (double)TIME, GENERATIONS, EVALUATIONS, STAGNATION, STAGNATION_EPSILON, TARGET_FITNESS };
+    return limits;
+}
+
+GeneticAlgorithm<Genome> algorithm;
+
+// Carries on from the snapshot at resume instead, seed and all, unless resume is empty
+void    prepare( GeneticAlgorithm<Genome>& population, unsigned int familySize, unsigned int threads, uint64_t seed, Truss a, Truss b,
+                 const std::string& resume, const std::string& name )
+{
+    // This is for mixed mode. Original (unmixed) mode uses population.init( familySize, a );
+    Genome first( a );
+    Genome second( b );
+    population.init( familySize / 2, first, familySize / 2, second );
+    population.setThreads( threads );
+    population.setFitnessCache( FITNESS_CACHE );
+    population.setMutationScheduling( MUTATION_SCHEDULING );
+    population.setSelection( Selection<Result>::create( SELECTION, TOURNAMENT_SIZE ) );
+    population.setMode( (GeneticAlgorithm<Genome>::Mode)MODE, TOURNAMENT_SIZE );
+    population.seed( seed );
+
+    if( resume.empty() )
+        return;
+
+    if( !Snapshot<Genome>::load( population, resume ) )
+        throw std::runtime_error( "Error: Could not carry on from " + resume );
+
+    std::cout << name << "Carrying on from generation " << population.generation() << " in " << resume << " (with the seed it was started with)" << std::endl;
+}
+
+// Runs a population until the limits say to stop, migrating through the island if there is one. Progress goes to
+//  log unless it is null, and there are no snapshots if snapshotPath is empty, nor counts if countersPath is.
+Outcome evolve( GeneticAlgorithm<Genome>& population, Island<Genome>* island, const StoppingPolicy::Limits& limits, const std::string& snapshotPath,
+                const std::string& countersPath, std::ostream* log, const std::string& name )
+{
+    Outcome outcome;
+    outcome.best.fitness = 0;
+    outcome.bestTime = 0.0;
+
+    StoppingPolicy policy( limits );
+    // A run carried on from a snapshot is limited from where it carried on
+    uint64_t startGeneration = population.generation();
+    uint64_t startEvaluations = population.evaluations();
+
+    Snapshot<Genome> snapshot( snapshotPath );
+
+    std::ofstream counters;
+    if( !countersPath.empty() )
+    {
+        counters.open( countersPath );
+        Counters::writeHeader( counters );
+    }
+    Counters::Counts counted = Counters::total();
+
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+
+    do
+    {
+        if( island )
+            island->process();
+        else
+            population.process();
+
+        elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+        if( counters.is_open() )
+        {
+            Counters::Counts now = Counters::total();
+            Counters::writeRow( counters, population.generation(), now.since( counted ) );
+            counted = now;
+        }
+
+        const Result& item = population.fittest();
+        if( item.fitness > outcome.best.fitness )
+        {
+            outcome.best = item;
+            outcome.bestTime = elapsed;
+
+            if( log )
+                *log << name << "New best fitness found: " << item.fitness << std::endl;
+        }
+
+        // If the last one is still being written this one is skipped, rather than holding everything up
+        if( !snapshotPath.empty() && SNAPSHOT_INTERVAL != 0 && population.generation() % SNAPSHOT_INTERVAL == 0 )
+            snapshot.save( population );
+    } while( !policy.stop( elapsed, population.generation() - startGeneration, population.evaluations() - startEvaluations, outcome.best.fitness,
+                           population.meanFitness() ) );
+
+    outcome.stopped = policy.reason();
+    outcome.evaluations = population.evaluations() - startEvaluations;
+
+    if( log )
+        *log << name << "Stopped on " << StoppingPolicy::name( outcome.stopped ) << " after " << population.generation() - startGeneration << " generations and "
+             << outcome.evaluations << " evaluations (" << outcome.evaluations / std::max( elapsed, 1e-9 ) << " a second)" << std::endl;
+
+    if( !snapshotPath.empty() )
+    {
+        snapshot.wait();
+        snapshot.save( population );
     }
 
-    Truss exb;
-    {
-        auto a = exb.nodes.insert( Node( -232.0, 0.0 ) ).first;
-        auto b = exb.nodes.insert( Node( -160.0, -100.0 ) ).first;
-        auto c = exb.nodes.insert( Node( -105.0, 0.0 ) ).first;
-        auto d = exb.nodes.insert( Node( -0.0, -100.0 ) ).first;
-        auto e = exb.nodes.insert( Node( 30.0, 0.0 ) ).first;
-        auto f = exb.nodes.insert( Node( 130.0, -100.0 ) ).first;
-        auto g = exb.nodes.insert( Node( 165.0, 0.0 ) ).first;
-        auto h = exb.nodes.insert( Node( 232.0, 0.0 ) ).first;
-
-        exb.connect( a, b, 1.0 );
-        exb.connect( a, c, 1.0 );
-        exb.connect( b, c, 1.0 );
-        exb.connect( b, d, 1.0 );
-        exb.connect( c, d, 1.0 );
-        exb.connect( c, e, 1.0 );
-        exb.connect( d, e, 1.0 );
-        exb.connect( d, f, 1.0 );
-        exb.connect( e, f, 1.0 );
-        exb.connect( e, g, 1.0 );
-        exb.connect( f, g, 1.0 );
-        exb.connect( f, h, 1.0 );
-        exb.connect( g, h, 1.0 );
+    return outcome;
+}
+
+// The load the truss can carry at its middle node before its weakest member gives (in the worst of LOAD_CASES, if any)
+Newton  maximumForce( Truss& truss )
+{
+    auto members = truss.calculateSafeties( truss.findMiddle() );
+    return std::min_element( members.begin(), members.end(), []( const Truss::Safety& a, const Truss::Safety& b ){ return a.maxForce < b.maxForce; } )->maxForce;
+}
+
+// One run of a batch, on its own with no console output or snapshots
+BatchRecord runJob( const BatchJob& job )
+{
+    Truss::fitnessIntensity = job.fitnessIntensity;
+    std::copy( job.mutationWeights, job.mutationWeights + Truss::MUTATIONS, Truss::mutationWeights );
+
+    GeneticAlgorithm<Genome> population;
+    prepare( population, job.familySize, job.threads, job.seed, Examples::exa(), Examples::exb(), "", "" );
+    population.setMutationScheduling( job.scheduling );
+
+    Outcome outcome = evolve( population, nullptr, job.stopping, "", "", nullptr, "" );
+
+    BatchRecord record;
+    record.generations = population.generation();
+    record.fitness = outcome.best.fitness;
+    Truss best = unpacked( outcome.best.item );
+    record.maxForce = outcome.best.fitness > 0.0 ? maximumForce( best ) : 0.0;
+    record.sticks = best.thicknessSum;
+    record.timeToBest = outcome.bestTime;
+    record.stopped = outcome.stopped;
+    record.evaluations = outcome.evaluations;
+
+    return record;
+}
+
+// Each island snapshots to a file of its own, numbered after the one given. Empty stays empty.
+std::string islandPath( const std::string& path, unsigned int index )
+{
+    return path.empty() ? path : path + "." + std::to_string( index );
+}
+
+// Snapshots go to snapshot (numbered), and are carried on from if resume is set
+Result  runIsland( unsigned int index, Channel& next, Channel& previous, const Truss& a, const Truss& b, unsigned int seedVal, const std::string& snapshot, bool resume )
+{
+    // Share the hardware out between the islands unless told otherwise
+    unsigned int threads = THREADS != 0 ? THREADS : std::max( std::thread::hardware_concurrency() / ISLANDS, 1u );
+
+    GeneticAlgorithm<Genome> population;
+    std::string name = "Island " + std::to_string( index ) + ": ";
+    std::string path = islandPath( snapshot, index );
+    std::string counters = *COUNTERS != '\0' ? COUNTERS + ("." + std::to_string( index )) : "";
+
+    prepare( population, FAMILY_SIZE / ISLANDS, threads, Random::Generator( seedVal ).split( index ).key(), a, b, resume ? path : "", name );
+
+    Island<Genome> island( population, next, previous, MIGRATION_INTERVAL, MIGRANTS );
+    Result best = evolve( population, &island, stoppingLimits(), path, counters, &std::cout, name ).best;
+    island.finish();
+
+    return best;
+}
+
+#ifndef _WIN32
+// Forks a process per island, linked round a ring of Unix domain sockets. Each one reports its fittest back
+//  through a socket of its own once it is done, and the fittest of those is returned.
+Result  runIslands( const Truss& a, const Truss& b, unsigned int seedVal, const std::string& snapshot, bool resume )
+{
+    // ring[i] carries migrants from island i to island i + 1
+    std::vector<int> ring( ISLANDS * 2 );
+    std::vector<int> reports( ISLANDS * 2 );
+    for( unsigned int i = 0; i < ISLANDS; ++i )
+    {
+        if( socketpair( AF_UNIX, SOCK_STREAM, 0, &ring[i * 2] ) != 0 || socketpair( AF_UNIX, SOCK_STREAM, 0, &reports[i * 2] ) != 0 )
+            throw std::runtime_error( "Error: Could not create the sockets linking the islands" );
     }
 
-    // This is for mixed mode. Original (unmixed) mode uses algorithm.init( FAMILY_SIZE, exa );
-	algorithm.init( FAMILY_SIZE / 2, exa, FAMILY_SIZE / 2, exb );
+    std::cout.flush();
 
-    Truss best;
-    double bestFitness = 0;
+    std::vector<pid_t> workers;
+    for( unsigned int i = 0; i < ISLANDS; ++i )
+    {
+        pid_t pid = fork();
+        if( pid < 0 )
+            throw std::runtime_error( "Error: Could not start an island process" );
 
-    std::cout << "Choose a seeding value (any integer)" << std::endl;
-    unsigned int seedVal;
-    std::cin >> seedVal;
+        if( pid == 0 )
+        {
+            unsigned int previous = (i + ISLANDS - 1) % ISLANDS;
 
-    Random::seed( seedVal );
+            // Keep only our own ends, otherwise a finished island would never look closed to the next one
+            for( unsigned int j = 0; j < ISLANDS; ++j )
+            {
+                if( j != i )
+                    close( ring[j * 2] );
+                if( j != previous )
+                    close( ring[j * 2 + 1] );
+                if( j != i )
+                    close( reports[j * 2] );
+                close( reports[j * 2 + 1] );
+            }
 
-    time_t start;
-    time_t now;
+            {
+                SocketChannel next( ring[i * 2] );
+                SocketChannel last( ring[previous * 2 + 1] );
+                SocketChannel report( reports[i * 2] );
 
-    time( &start );
-    time( &now );
+                std::vector<Result> best( 1, runIsland( i, next, last, a, b, seedVal, snapshot, resume ) );
+                std::vector<char> message;
+                Island<Genome>::pack( best, message );
+                report.send( message );
+                report.close();
+            }
 
-    // Now process
-    do
+            std::cout.flush();
+            _exit( 0 );
+        }
+
+        workers.push_back( pid );
+    }
+
+    for( unsigned int i = 0; i < ISLANDS; ++i )
+    {
+        close( ring[i * 2] );
+        close( ring[i * 2 + 1] );
+        close( reports[i * 2] );
+    }
+
+    Result best;
+    best.fitness = 0;
+
+    for( unsigned int i = 0; i < ISLANDS; ++i )
+    {
+        SocketChannel report( reports[i * 2 + 1] );
+        std::vector<char> message;
+        std::vector<Result> results;
+
+        if( report.receive( message ) && Island<Genome>::unpack( message, results ) && results.size() == 1 && results[0].fitness > best.fitness )
+            best = results[0];
+    }
+
+    for( auto i = workers.begin(); i != workers.end(); ++i )
+        waitpid( *i, nullptr, 0 );
+
+    return best;
+}
+#else
+// Runs every island on a thread of its own, linked round a ring of local channels
+Result  runIslands( const Truss& a, const Truss& b, unsigned int seedVal, const std::string& snapshot, bool resume )
+{
+    std::vector<LocalChannel> ring( ISLANDS );
+    std::vector<Result> results( ISLANDS );
+    std::vector<std::thread> islands;
+
+    for( unsigned int i = 0; i < ISLANDS; ++i )
+    {
+        islands.emplace_back( [&, i]
+        {
+            results[i] = runIsland( i, ring[i], ring[(i + ISLANDS - 1) % ISLANDS], a, b, seedVal, snapshot, resume );
+        } );
+    }
+
+    for( auto i = islands.begin(); i != islands.end(); ++i )
+        i->join();
+
+    return *std::max_element( results.begin(), results.end(), []( const Result& a, const Result& b ){ return a.fitness < b.fitness; } );
+}
+#endif
+
+// GA_Joints asks for a seed on the console. GA_Joints --seed n runs with that seed and never waits on the console,
+//  GA_Joints --resume file carries on from the snapshot in file (see SNAPSHOT), seed and all, and GA_Joints --batch
+//  runs a whole batch, see Batch.h.
+int main( int argc, char** argv )
+{
+    Truss::solver = SOLVER;
+    Truss::loadCases = LOAD_CASES;
+    SolvePlans::setCapacity( SOLVE_PLANS );
+
+    if( argc >= 2 && strcmp( argv[1], "--batch" ) == 0 )
+    {
+        Batch batch;
+        std::string error;
+        if( !batch.parse( argc - 2, argv + 2, error ) )
+        {
+            std::cerr << error << std::endl << Batch::USAGE << std::endl;
+            return 1;
+        }
+
+        if( !batch.run( runJob ) )
+        {
+            std::cerr << "Could not write the results to " << argv[2] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Create example trusses
+    Truss exa = Examples::exa();
+    Truss exb = Examples::exb();
+
+    const char* seedArgument = nullptr;
+    std::string resume;
+    for( int i = 1; i < argc; i += 2 )
     {
-        algorithm.process();
+        if( i + 1 == argc )
+        {
+            std::cerr << "Option " << argv[i] << " needs a value" << std::endl;
+            return 1;
+        }
 
-        auto item = algorithm.fittest();
-        if( item.fitness > bestFitness )
+        if( strcmp( argv[i], "--seed" ) == 0 )
+            seedArgument = argv[i + 1];
+        else if( strcmp( argv[i], "--resume" ) == 0 )
+            resume = argv[i + 1];
+        else
         {
-            best = item.item;
-            bestFitness = item.fitness;
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    bool interactive = seedArgument == nullptr && resume.empty();
+    unsigned int seedVal = 0;
 
-            std::cout << "New best fitness found: " << bestFitness << std::endl;
+    if( interactive )
+    {
+        std::cout << "Choose a seeding value (any integer)" << std::endl;
+        std::cin >> seedVal;
+    }
+    else if( seedArgument != nullptr )
+        seedVal = (unsigned int)strtoul( seedArgument, nullptr, 10 );
+
+    // What the results file says the run was seeded with, which for a resumed run is whatever its snapshots say
+    std::string seeds = std::to_string( seedVal );
+
+    // Every snapshot has to be there before anything starts, rather than some islands carrying on and some starting afresh
+    if( !resume.empty() )
+    {
+        seeds.clear();
+        for( unsigned int i = 0; i < ISLANDS; ++i )
+        {
+            std::string path = ISLANDS > 1 ? islandPath( resume, i ) : resume;
+            uint64_t seed, generation;
+            if( !Snapshot<Genome>::peek( path, seed, generation ) )
+            {
+                std::cerr << "There is no snapshot to carry on from in " << path << std::endl;
+                return 1;
+            }
+            seeds += (i == 0 ? "" : ", ") + std::to_string( seed );
         }
+        if( ISLANDS > 1 )
+            seeds += " (one per island, carried on from " + resume + ")";
+        else
+            seeds += " (carried on from " + resume + ")";
+    }
+
+    // A resumed run saves back to where it came from
+    std::string snapshot = !resume.empty() ? resume : SNAPSHOT != nullptr ? SNAPSHOT : "";
+
+    Truss best;
+
+    if( ISLANDS > 1 )
+        best = unpacked( runIslands( exa, exb, seedVal, snapshot, !resume.empty() ).item );
+    else
+    {
+        prepare( algorithm, FAMILY_SIZE, THREADS, seedVal, exa, exb, resume, "" );
+
+        // Allocations made while setting up are not interesting, only those made per generation are
+        uint64_t startAllocations = Allocations::count();
+        uint64_t startGeneration = algorithm.generation();
 
-        time( &now );
-    } while( difftime( now, start ) < TIME );
+        Counters::Counts startCounts = Counters::total();
+
+        best = unpacked( evolve( algorithm, nullptr, stoppingLimits(), snapshot, COUNTERS, &std::cout, "" ).best.item );
+
+        Counters::Counts counts = Counters::total().since( startCounts );
+        uint64_t rejected = 0;
+        for( unsigned int i = Counters::REJECTED_DETERMINANCY; i <= Counters::REJECTED_NO_MIDDLE; ++i )
+            rejected += counts[(Counters::Counter)i];
+
+        SolvePlans::Statistics plans = SolvePlans::statistics();
+
+        std::cout << "Fitness cache hit rate: " << 100.0 * algorithm.totalCacheStatistics().hitRate() << "%" << std::endl;
+        std::cout << "Solve plan hit rate: " << 100.0 * plans.hitRate() << "% (" << plans.plans << " plans kept in " << plans.bytes / 1024 << " KB)" << std::endl;
+        if( MUTATION_SCHEDULING == MutationScheduler::ADAPTIVE )
+        {
+            const char* const names[Truss::MUTATIONS] = { "addNode", "removeNode", "thicken", "moveNode" };
+
+            std::cout << "Mutation odds reached:";
+            for( unsigned int i = 0; i < Truss::MUTATIONS; ++i )
+                std::cout << " " << names[i] << " " << 100.0 * algorithm.scheduler().probability( i ) << "%";
+            std::cout << std::endl;
+        }
+        std::cout << "Evaluations rejected before solving: " << (counts[Counters::EVALUATIONS] == 0 ? 0.0 : 100.0 * rejected / counts[Counters::EVALUATIONS]) << "%" << std::endl;
+        std::cout << "Allocations per generation: " << (double)(Allocations::count() - startAllocations) / (algorithm.generation() - startGeneration) << std::endl;
+    }
 
     auto members = best.calculateSafeties( best.findMiddle() );
-    double minimum = std::min_element( members.begin(), members.end(), []( const Truss::Safety& a, const Truss::Safety& b ){ return a.maxForce < b.maxForce; } )->maxForce;
+    double minimum = maximumForce( best );
+
+    // Only does anything in a build with TRACING set, see Trace.h
+    TRACE_WRITE( "Trace.json" );
 
     std::cout << "Application ended. Truss being written to file in the form of points on a cartesian plane and connection definitions." << std::endl;
     std::cout << "Final design can hold a maximum force of: " << minimum << " Newtons, expected." << std::endl;
 
     std::fstream file( "TrussDesign.txt", std::fstream::out | std::fstream::trunc );
 
-    file << "Using seed of: " << seedVal << std::endl;
+    file << "Using seed of: " << seeds << std::endl;
 
     unsigned int count = 0;
     for( auto i = best.nodes.begin(); i != best.nodes.end(); (++i), (++count) )
@@ -121,22 +515,25 @@ int main()
 
     for( auto i = members.begin(); i != members.end(); ++i )
     {
-        int a = (int)std::distance( best.nodes.begin(), i->nodeA );
-        int b = (int)std::distance( best.nodes.begin(), i->nodeB );
+        int a = (int)i->nodeA;
+        int b = (int)i->nodeB;
         // Member info:
         file << "Node " << a << " connected to Node " << b << " using " << i->thickness << " sticks." << std::endl;
         file << "\tProportion of force = " << i->forceProportion << " (" << (i->tension ? "tension)." : "compression).") << std::endl;
-        file << "\tLength of member = " << distance( *(i->nodeA), *(i->nodeB) ) << "mm." << std::endl;
+        file << "\tLength of member = " << distance( best.nodes[i->nodeA], best.nodes[i->nodeB] ) << "mm." << std::endl;
     }
 
-    file << "Total span = " << distance( *best.nodes.begin(), *best.nodes.rbegin() ) << "mm." << std::endl;
-    file << "And middle point at: " << distance( *best.nodes.begin(), *best.findMiddle() ) << "mm from left." << std::endl;
+    file << "Total span = " << distance( best.nodes.front(), best.nodes.back() ) << "mm." << std::endl;
+    file << "And middle point at: " << distance( best.nodes.front(), best.nodes[best.findMiddle()] ) << "mm from left." << std::endl;
     file << "Total of " << best.nodes.size() << " nodes, " << best.memberCount << " members, and " << best.thicknessSum << " popsicle sticks." << std::endl;
 
     file.close();
 
-    std::cout << "Press any key to continue" << std::endl;
+    if( interactive )
+    {
+        std::cout << "Press any key to continue" << std::endl;
 
-    std::cin.ignore();
-    std::cin.get();
+        std::cin.ignore();
+        std::cin.get();
+    }
 }
\ No newline at end of file